@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef ACCELERATOR_H_INCLUDED
+#define ACCELERATOR_H_INCLUDED
+
+#include "boundingbox.h"
+#include "intersection.h"
+#include "ray.h"
+#include "raypacket.h"
+#include "shape.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace RadRt
+{
+
+/**
+ * Spatial index over the shapes of a scene, answering the two ray queries
+ * the raytracer needs: the closest hit along a ray, and whether anything
+ * blocks a ray before a given distance.
+ */
+class Accelerator
+{
+public:
+
+    virtual ~Accelerator() {};
+
+    /**
+     * Build the structure over a set of shapes, discarding any previous
+     * contents. The shapes are not owned by the structure and must outlive
+     * it.
+     *
+     * @param shapes Shapes to index.
+     */
+    virtual void build(const std::vector<Shape*> &shapes) = 0;
+
+    /**
+     * Bring the structure up to date after the shapes it was built over have
+     * moved. Structures that can adjust to the new positions do so without
+     * a full build; the rest simply build again.
+     *
+     * @param shapes The same shapes, in the same order, as passed to the
+     *        last build.
+     */
+    virtual void update(const std::vector<Shape*> &shapes)
+    {
+        build(shapes);
+    };
+
+    /**
+     * Find the closest intersection of a ray with the indexed shapes.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param hit Set to the closest intersection; left untouched if the ray
+     *        hits nothing.
+     * @return True if the ray hits a shape.
+     */
+    virtual bool closest_intersection(const Ray &ray,
+                                      Intersection &hit) const = 0;
+
+    /**
+     * Find the closest intersection of every ray of a packet. The result
+     * for each ray is that of closest_intersection(); structures that can
+     * walk a coherent packet at once do so, the rest trace the rays one by
+     * one.
+     *
+     * @param packet Rays to trace.
+     * @param hits Array of one intersection per ray, each set as by
+     *        closest_intersection().
+     * @param found Array of one flag per ray, set to whether it hits a
+     *        shape.
+     */
+    virtual void closest_intersections(const RayPacket &packet,
+                                       Intersection hits[],
+                                       bool found[]) const
+    {
+        for (int index = 0; index < packet.size(); ++index)
+        {
+            found[index] = closest_intersection(packet.ray(index),
+                                                hits[index]);
+        }
+    };
+
+    /**
+     * Determine whether anything blocks a ray within its interval. The
+     * query stops at the first opaque shape found; transparent shapes along
+     * the way attenuate the light reaching the far end instead of blocking
+     * it.
+     *
+     * @param ray Ray to trace.
+     * @param origin Intersection the ray leaves from, whose surface is
+     *        skipped, or nullptr.
+     * @param transmission Multiplied by the transmissive constant of every
+     *        transparent shape the ray crosses.
+     * @return True if an opaque shape blocks the ray.
+     */
+    virtual bool occluded(const Ray &ray, const Intersection *origin,
+                          float &transmission) const = 0;
+
+    /**
+     * Get the bounds of every indexed shape.
+     */
+    virtual BoundingBox bounds() const = 0;
+
+    /**
+     * Write the built structure to a file, so that it can be restored with
+     * load() instead of being built again.
+     *
+     * @param filename File to write.
+     * @param key Identifies the shapes the structure was built over.
+     * @return True if the structure was written. Structures that are cheap
+     *         to build do not support caching and always return false.
+     */
+    virtual bool save(const std::string & /* filename */,
+                      uint64_t /* key */) const
+    {
+        return false;
+    };
+
+    /**
+     * Restore a structure written by save(), in place of a call to build().
+     *
+     * @param filename File to read.
+     * @param key Must match the key the file was saved with.
+     * @param shapes The same shapes, in the same order, as the structure
+     *        was built over.
+     * @return True if the structure was restored. On failure the structure
+     *         is left unchanged and must be built instead.
+     */
+    virtual bool load(const std::string & /* filename */,
+                      uint64_t /* key */,
+                      const std::vector<Shape*> & /* shapes */)
+    {
+        return false;
+    };
+};
+
+}   // namespace RadRt
+
+#endif // ACCELERATOR_H_INCLUDED
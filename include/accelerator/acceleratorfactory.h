@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef ACCELERATORFACTORY_H_INCLUDED
+#define ACCELERATORFACTORY_H_INCLUDED
+
+#include <string>
+#include "accelerator.h"
+
+namespace RadRt
+{
+
+class AcceleratorFactory
+{
+public:
+
+    Accelerator *create(std::string classname);
+};
+
+}   // namespace RadRt
+
+#endif // ACCELERATORFACTORY_H_INCLUDED
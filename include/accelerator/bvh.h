@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef BVH_H_INCLUDED
+#define BVH_H_INCLUDED
+
+#include "accelerator.h"
+#include "geometrystore.h"
+
+namespace RadRt
+{
+
+class ThreadPool;
+
+/**
+ * Bounding volume hierarchy over the shapes of a scene. The hierarchy is
+ * built top-down using the surface area heuristic evaluated over a fixed
+ * number of centroid bins, and stored as a flat array of nodes in depth-first
+ * order so that the left child of an interior node always directly follows
+ * its parent.
+ *
+ * The leaves hold primitives rather than shapes, so that each triangle of a
+ * mesh is placed on its own.
+ *
+ * Large scenes are built in parallel: the workers share the passes over the
+ * primitives at the top of the tree, then build the subtrees below it
+ * concurrently. The result is the same tree a serial build produces. The
+ * workers are kept between builds rather than started for each one.
+ *
+ * A built hierarchy can be saved to a flat binary file and mapped back into
+ * memory later, which skips building altogether.
+ */
+class Bvh : public Accelerator
+{
+public:
+
+    Bvh();
+    ~Bvh();
+
+    void build(const std::vector<Shape*> &shapes);
+
+    /**
+     * Refit the hierarchy to moved shapes, recomputing node bounds bottom-up
+     * while keeping the tree itself. Once the shapes have moved far enough
+     * that the refitted tree is markedly worse than the one originally
+     * built, it is rebuilt instead.
+     */
+    void update(const std::vector<Shape*> &shapes);
+
+    /**
+     * Find the closest intersection of a ray. Subtrees whose bounds lie
+     * beyond the closest intersection found so far are skipped.
+     */
+    bool closest_intersection(const Ray &ray, Intersection &hit) const;
+
+    /**
+     * Find the closest intersections of a packet of rays by walking the
+     * hierarchy once for the whole packet. Nodes are first tested against
+     * bounds on all the rays at once, then against four rays at a time;
+     * rays carry on alone once the others have left them. Packets whose
+     * rays start at different points, or whose directions differ in sign,
+     * are traced ray by ray.
+     */
+    void closest_intersections(const RayPacket &packet, Intersection hits[],
+                               bool found[]) const;
+
+    /**
+     * Determine whether anything blocks a ray. Children are visited in
+     * storage order and the walk ends at the first opaque hit.
+     */
+    bool occluded(const Ray &ray, const Intersection *from,
+                  float &transmission) const;
+
+    BoundingBox bounds() const;
+
+    bool save(const std::string &filename, uint64_t key) const;
+
+    /**
+     * Restore a hierarchy written by save(). The file is mapped into memory
+     * and traversed in place. Its nodes are walked once to check that they
+     * form a tree over the primitives, so that a damaged file is rebuilt
+     * instead of traversed.
+     */
+    bool load(const std::string &filename, uint64_t key,
+              const std::vector<Shape*> &shapes);
+
+    int node_count() const { return m_node_count; };
+
+    /**
+     * Set the threads used to build large hierarchies. The pool must
+     * outlive every build using it, and may be shared with other work.
+     *
+     * @param pool Threads to build on, or nullptr, the default, for a pool
+     *        of one thread per hardware thread shared by every hierarchy
+     *        in the process.
+     */
+    void set_thread_pool(ThreadPool *pool)
+    {
+        m_thread_pool = pool;
+    };
+
+private:
+
+    // Collapses the built hierarchy into its own layout
+    friend class Qbvh;
+
+    /**
+     * A node of the flattened hierarchy. Leaves reference a range of the
+     * reordered primitive array, interior nodes the index of their right child.
+     */
+    struct Node
+    {
+        float min[3];
+        float max[3];
+
+        // First primitive of a leaf, or right child of an interior node.
+        unsigned int offset;
+
+        // Number of primitives in a leaf, zero for interior nodes.
+        unsigned short count;
+
+        // Axis the node was split along, used to order traversal.
+        unsigned short axis;
+    };
+
+    /**
+     * Leading part of a saved hierarchy, followed by the nodes and then the
+     * index of the primitive behind each entry of the reordered primitive
+     * array, counting the primitives of all shapes in order.
+     */
+    struct CacheHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t node_size;
+        uint64_t key;
+        uint32_t shape_count;
+        uint32_t node_count;
+    };
+
+    /**
+     * Rays of a packet sharing one origin, laid out for testing four at a
+     * time, together with bounds on the whole packet.
+     */
+    struct Packet
+    {
+        int size;
+        float origin[3];
+        float inverse_direction[3][RayPacket::MAX_SIZE];
+        float t_min[RayPacket::MAX_SIZE];
+        float t_max[RayPacket::MAX_SIZE];
+
+        // Whether the reciprocal directions along each axis are negative,
+        // which is the same for every ray
+        bool negative[3];
+
+        // Range of the reciprocal directions and of the ray intervals, or
+        // bounded false if some reciprocal is infinite and the range is of
+        // no use
+        bool bounded;
+        float inverse_min[3];
+        float inverse_max[3];
+        float t_min_min;
+        float t_max_max;
+    };
+
+    /**
+     * Per-primitive data used while building.
+     */
+    struct Primitive
+    {
+        BoundingBox bounds;
+        Point3d centroid;
+        unsigned int index;
+    };
+
+    /**
+     * Number of centroid bins evaluated per axis when searching for a split.
+     */
+    static const int BIN_COUNT = 16;
+
+    /**
+     * Shape counts and bounds of the centroid bins of a range of
+     * primitives, along each axis.
+     */
+    struct Bins
+    {
+        BoundingBox bounds[3][BIN_COUNT];
+        unsigned int count[3][BIN_COUNT];
+
+        Bins()
+        {
+            for (int axis = 0; axis < 3; ++axis)
+                for (int bin = 0; bin < BIN_COUNT; ++bin)
+                    count[axis][bin] = 0;
+        }
+
+        void merge(const Bins &other)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                for (int bin = 0; bin < BIN_COUNT; ++bin)
+                {
+                    count[axis][bin] += other.count[axis][bin];
+                    bounds[axis][bin].expand(other.bounds[axis][bin]);
+                }
+            }
+        }
+    };
+
+    /**
+     * Interior node at the top of a parallel build. Children are either
+     * other top nodes or, when negative, the one-based index of a subtree.
+     */
+    struct TopNode
+    {
+        float min[3];
+        float max[3];
+        int axis;
+        int left;
+        int right;
+    };
+
+    /**
+     * Part of the tree built by a single worker, laid out like the final
+     * node array but starting at index zero.
+     */
+    struct Subtree
+    {
+        std::vector<Node> nodes;
+    };
+
+    /**
+     * Check that nodes read from a file form a tree that traversal can
+     * walk: every child and primitive in range, bounds that are numbers,
+     * and no deeper than the traversal stack.
+     */
+    static bool valid_nodes(const Node nodes[], unsigned int node_count,
+                            unsigned int shape_count);
+
+    static void init_primitive(Primitive &primitive,
+                               const BoundingBox &bounds,
+                               unsigned int index);
+
+    static int bin_index(float centroid, float centroid_min, float scale);
+
+    static void compute_bounds(const std::vector<Primitive> &primitives,
+                               unsigned int begin, unsigned int end,
+                               BoundingBox &bounds,
+                               BoundingBox &centroid_bounds,
+                               ThreadPool *pool);
+
+    static void fill_bins(const std::vector<Primitive> &primitives,
+                          unsigned int begin, unsigned int end,
+                          const BoundingBox &centroid_bounds, Bins &bins);
+
+    /**
+     * Choose how to split a range of primitives and partition it
+     * accordingly.
+     *
+     * @return The first primitive of the right-hand side, or begin if the
+     *         range should become a leaf.
+     */
+    static unsigned int split(std::vector<Primitive> &primitives,
+                              unsigned int begin, unsigned int end,
+                              int depth, const BoundingBox &bounds,
+                              const BoundingBox &centroid_bounds,
+                              int &axis, ThreadPool *pool);
+
+    static void build_node(std::vector<Node> &nodes,
+                           std::vector<Primitive> &primitives,
+                           unsigned int begin, unsigned int end, int depth,
+                           ThreadPool *pool);
+
+    static int build_top(std::vector<TopNode> &top,
+                         std::vector<Subtree> &subtrees,
+                         std::vector<Primitive> &primitives,
+                         unsigned int begin, unsigned int end, int depth,
+                         unsigned int subtree_size, ThreadPool *pool);
+
+    /**
+     * Move a child reference of a top node built into lists of its own to
+     * lists that already hold the given numbers of top nodes and subtrees.
+     */
+    static int relocate(int reference, int top_base, int subtree_base);
+
+    void flatten(const std::vector<TopNode> &top,
+                 const std::vector<Subtree> &subtrees, int reference);
+
+    /**
+     * Get the expected cost of a ray query against the hierarchy, relative
+     * to the cost of intersecting a single shape, by the surface area
+     * heuristic.
+     */
+    float cost() const;
+
+    inline bool intersect_node(const Node &node,
+                               const float origin[3],
+                               const float inverse_direction[3],
+                               float t_min, float t_max) const;
+
+    /**
+     * Test whether a node may be hit by any ray of a packet, from the
+     * bounds on the whole packet.
+     */
+    inline bool intersect_node(const Node &node, const Packet &packet) const;
+
+    /**
+     * Test a node against four rays of a packet, exactly as intersect_node()
+     * tests a single ray.
+     *
+     * @param lane First of the four rays.
+     * @return Mask of the rays that hit the node, with bit 0 for lane.
+     */
+    inline int intersect_node(const Node &node, const Packet &packet,
+                              int lane) const;
+
+    /**
+     * Find the closest intersection of a ray within a subtree.
+     *
+     * @param bounded Ray to trace, shortened to each hit found.
+     */
+    bool intersect_subtree(unsigned int root, const float origin[3],
+                           const float inverse_direction[3], Ray &bounded,
+                           Intersection &hit) const;
+
+    /**
+     * Discard the current hierarchy, unmapping it if it was loaded.
+     */
+    void clear();
+
+    // Nodes of a built hierarchy. Traversal goes through m_node_data, which
+    // points either here or into a mapped cache file.
+    std::vector<Node> m_nodes;
+    const Node *m_node_data;
+    unsigned int m_node_count;
+
+    void *m_mapping;
+    size_t m_mapping_size;
+
+    // Shape and primitive within it behind each leaf entry, in leaf order.
+    std::vector<Shape*> m_shapes;
+    std::vector<unsigned int> m_primitives;
+
+    // Index in the list of all primitives of each entry of m_shapes.
+    std::vector<unsigned int> m_shape_indices;
+
+    // m_shapes and m_primitives compiled for the leaves to test.
+    GeometryStore m_geometry;
+
+    ThreadPool *m_thread_pool;
+
+    // Cost of the hierarchy when it was built, or zero if not yet known.
+    float m_build_cost;
+
+    // Not copyable, as it may own a mapping
+    Bvh(const Bvh&);
+    Bvh &operator=(const Bvh&);
+
+};  // class Bvh
+
+}   // namespace RadRt
+
+#endif // BVH_H_INCLUDED
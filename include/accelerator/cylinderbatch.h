@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef CYLINDERBATCH_H_INCLUDED
+#define CYLINDERBATCH_H_INCLUDED
+
+#include "shape.h"
+
+#include <vector>
+
+namespace RadRt
+{
+
+class Cylinder;
+class Intersection;
+class Ray;
+
+/**
+ * Cylinders stored back to back, one array per component of their frames,
+ * so that a ray is tested against four of them at once with SSE
+ * instructions.
+ */
+class CylinderBatch
+{
+public:
+
+    CylinderBatch() {};
+    ~CylinderBatch() {};
+
+    void assign(const std::vector<Cylinder*> &cylinders);
+
+    /**
+     * Read the cylinders again after they have moved.
+     */
+    void update();
+
+    void clear();
+
+    unsigned int size() const { return m_cylinders.size(); };
+
+    /**
+     * Find the closest intersection of a ray with a range of the cylinders.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param begin First cylinder to test.
+     * @param end Cylinder after the last one to test.
+     * @param hit Set to the closest intersection; left untouched if the ray
+     *        hits none of the cylinders.
+     * @return True if the ray hits one of the cylinders.
+     */
+    bool intersect(const Ray &ray, unsigned int begin, unsigned int end,
+                   Intersection &hit) const;
+
+    /**
+     * Test whether a range of the cylinders blocks a ray, the way
+     * Shape::occludes does for each of them.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param begin First cylinder to test.
+     * @param end Cylinder after the last one to test.
+     * @param origin Shape the ray leaves from, which is ignored; may be
+     *        null.
+     * @param transmission Multiplied by the transmissive constant of each
+     *        transparent cylinder the ray passes through.
+     * @return True if an opaque cylinder blocks the ray.
+     */
+    bool occluded(const Ray &ray, unsigned int begin, unsigned int end,
+                  const Shape *origin, float &transmission) const;
+
+private:
+
+    // Entries past the last cylinder, so that every group of four starting
+    // at a cylinder can be loaded
+    static const unsigned int PADDING = 3;
+
+    /**
+     * Intersect a ray with the four cylinders starting at some index.
+     *
+     * @return A mask of the cylinders before end hit within the ray interval,
+     *         closer than t_max; the distances are written to t.
+     */
+    int test(const Ray &ray, unsigned int index, unsigned int end,
+             float t_max, float t[4]) const;
+
+    std::vector<Cylinder*> m_cylinders;
+
+    std::vector<float> m_base_x;
+    std::vector<float> m_base_y;
+    std::vector<float> m_base_z;
+    std::vector<float> m_axis_x;
+    std::vector<float> m_axis_y;
+    std::vector<float> m_axis_z;
+    std::vector<float> m_height;
+    std::vector<float> m_radius_squared;
+
+};  // class CylinderBatch
+
+}   // namespace RadRt
+
+#endif // CYLINDERBATCH_H_INCLUDED
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef GEOMETRYSTORE_H_INCLUDED
+#define GEOMETRYSTORE_H_INCLUDED
+
+#include "cylinderbatch.h"
+#include "rectanglebatch.h"
+#include "shape.h"
+#include "spherebatch.h"
+#include "trianglebatch.h"
+
+#include <vector>
+
+namespace RadRt
+{
+
+class Intersection;
+class Ray;
+
+/**
+ * An array of primitives compiled for rendering. Spheres, cylinders,
+ * rectangles and the triangles of meshes move into a batch of their own
+ * type, where they are intersected without a virtual call; any other shape
+ * is still reached through its Shape pointer.
+ *
+ * Accelerators compile the array they order their primitives in, and test
+ * ranges of its slots. The batches are filled in slot order, so that the
+ * primitives of one type within any range of slots are a range of their
+ * batch.
+ */
+class GeometryStore
+{
+public:
+
+    GeometryStore() {};
+    ~GeometryStore() {};
+
+    /**
+     * List the primitives of some shapes, in order.
+     *
+     * @param shapes Shapes to list the primitives of.
+     * @param primitive_shapes Set to the shape of each primitive.
+     * @param primitives Set to the index of each primitive within its
+     *        shape.
+     */
+    static void list_primitives(const std::vector<Shape*> &shapes,
+                                std::vector<Shape*> &primitive_shapes,
+                                std::vector<unsigned int> &primitives);
+
+    /**
+     * Compile an array of primitives, as listed by list_primitives() and
+     * possibly reordered.
+     */
+    void compile(const std::vector<Shape*> &primitive_shapes,
+                 const std::vector<unsigned int> &primitives);
+
+    /**
+     * Read the shapes again after they have moved.
+     */
+    void update();
+
+    void clear();
+
+    /**
+     * Find the closest intersection of a ray with a range of slots.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param begin First slot to test.
+     * @param end Slot after the last one to test.
+     * @param hit Set to the closest intersection; left untouched if the ray
+     *        hits none of the shapes.
+     * @return True if the ray hits one of the shapes.
+     */
+    bool intersect(const Ray &ray, unsigned int begin, unsigned int end,
+                   Intersection &hit) const;
+
+    /**
+     * Test whether the shapes of a range of slots block a ray, as
+     * Accelerator::occluded does.
+     */
+    bool occluded(const Ray &ray, unsigned int begin, unsigned int end,
+                  const Intersection *origin, float &transmission) const;
+
+private:
+
+    enum ShapeType
+    {
+        SPHERE,
+        CYLINDER,
+        RECTANGLE,
+        TRIANGLE,
+        OTHER,
+        SHAPE_TYPE_COUNT
+    };
+
+    static ShapeType type_of(Shape *shape);
+
+    // m_first[type][i] is the number of primitives of a type in the slots
+    // before slot i, and so the first of them at or after slot i.
+    std::vector<unsigned int> m_first[SHAPE_TYPE_COUNT];
+
+    SphereBatch m_spheres;
+    CylinderBatch m_cylinders;
+    RectangleBatch m_rectangles;
+    TriangleBatch m_triangles;
+    std::vector<Shape*> m_others;
+
+};  // class GeometryStore
+
+}   // namespace RadRt
+
+#endif // GEOMETRYSTORE_H_INCLUDED
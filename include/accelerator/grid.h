@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef GRID_H_INCLUDED
+#define GRID_H_INCLUDED
+
+#include "accelerator.h"
+#include "geometrystore.h"
+
+namespace RadRt
+{
+
+/**
+ * Uniform grid over the primitives of a scene, traversed with a 3D digital
+ * differential analyzer. Like the hierarchies, the grid indexes each
+ * triangle of a mesh on its own, so a cell only holds the triangles that
+ * overlap it. The resolution follows the primitive density, so scenes of
+ * many similarly sized primitives end up with a few per cell. Cells that
+ * still hold many primitives are refined once by a nested grid covering
+ * just that cell.
+ *
+ * Building is linear in the number of primitives, which makes the grid the
+ * cheapest structure to rebuild for scenes that change every frame.
+ */
+class Grid : public Accelerator
+{
+public:
+
+    Grid();
+    ~Grid();
+
+    void build(const std::vector<Shape*> &shapes);
+
+    /**
+     * Find the closest intersection of a ray. Cells are visited front to
+     * back, and the walk ends at the first cell containing a hit.
+     */
+    bool closest_intersection(const Ray &ray, Intersection &hit) const;
+
+    /**
+     * Determine whether anything blocks a ray. A transparent shape
+     * overlapping several cells only attenuates the ray in the first of
+     * them, so that each is accounted for once.
+     */
+    bool occluded(const Ray &ray, const Intersection *origin,
+                  float &transmission) const;
+
+    BoundingBox bounds() const { return m_bounds; };
+
+private:
+
+    /**
+     * Index primitives within a fixed region.
+     *
+     * @param shapes Shape of each primitive.
+     * @param primitives Index of each primitive within its shape.
+     * @param ids Number of each primitive among those of the whole scene.
+     * @param bounds Region covered by the grid.
+     * @param level Refinement level; only top-level cells are refined.
+     */
+    void build_cells(const std::vector<Shape*> &shapes,
+                     const std::vector<unsigned int> &primitives,
+                     const std::vector<unsigned int> &ids,
+                     const BoundingBox &bounds, int level);
+
+    void clear();
+
+    int cell_index(int x, int y, int z) const
+    {
+        return (z * m_resolution[1] + y) * m_resolution[0] + x;
+    }
+
+    /**
+     * Walk the cells pierced by a ray between two distances, front to back,
+     * descending into refined cells. The visitor is called with the geometry
+     * and slot ids of the grid holding each cell, the range of slots of the
+     * cell, and the distances at which the ray enters and leaves it, and
+     * returns true to end the walk.
+     *
+     * @return True if the visitor ended the walk.
+     */
+    template <typename Visitor>
+    bool walk(const Ray &ray, float t_min, float t_max,
+              Visitor &visitor) const;
+
+    BoundingBox m_bounds;
+
+    int m_resolution[3];
+    float m_cell_size[3];
+
+    // Primitives of cell i are the slots m_cell_offsets[i] up to
+    // m_cell_offsets[i + 1] of m_geometry, laid out cell by cell so that a
+    // primitive overlapping several cells has a slot in each of them.
+    std::vector<unsigned int> m_cell_offsets;
+    GeometryStore m_geometry;
+
+    // Scene-wide number of the primitive in each slot, telling apart the
+    // copies of one primitive.
+    std::vector<unsigned int> m_slot_ids;
+
+    // Nested grid of each refined cell, or nullptr.
+    std::vector<Grid*> m_subgrids;
+
+};  // class Grid
+
+}   // namespace RadRt
+
+#endif // GRID_H_INCLUDED
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef QBVH_H_INCLUDED
+#define QBVH_H_INCLUDED
+
+#include "accelerator.h"
+#include "geometrystore.h"
+
+namespace RadRt
+{
+
+class Bvh;
+
+/**
+ * Bounding volume hierarchy with four children per node. The bounds of all
+ * four children are stored together, one array per coordinate, so that a
+ * ray is tested against them at once with SSE instructions.
+ *
+ * The hierarchy is built by collapsing a binary Bvh: each node takes the
+ * place of up to three levels of the binary tree, always opening the child
+ * with the largest surface area. Nodes are aligned to cache lines.
+ */
+class Qbvh : public Accelerator
+{
+public:
+
+    Qbvh();
+    ~Qbvh();
+
+    void build(const std::vector<Shape*> &shapes);
+
+    /**
+     * Find the closest intersection of a ray. Children are visited nearest
+     * first, and those whose bounds lie beyond the closest intersection
+     * found so far are skipped.
+     */
+    bool closest_intersection(const Ray &ray, Intersection &hit) const;
+
+    bool occluded(const Ray &ray, const Intersection *from,
+                  float &transmission) const;
+
+    BoundingBox bounds() const { return m_bounds; };
+
+    int node_count() const { return m_node_count; };
+
+private:
+
+    static const int WIDTH = 4;
+
+    /**
+     * A node of the hierarchy, two cache lines long. A child is either
+     * another node, a leaf referencing a range of the reordered shape array,
+     * or empty. Empty children have bounds no ray can enter.
+     */
+    struct Node
+    {
+        float min_x[WIDTH];
+        float min_y[WIDTH];
+        float min_z[WIDTH];
+        float max_x[WIDTH];
+        float max_y[WIDTH];
+        float max_z[WIDTH];
+
+        // Index of a child node, or first shape of a leaf.
+        unsigned int child[WIDTH];
+
+        // Number of shapes in a leaf, zero for nodes and empty children.
+        unsigned short count[WIDTH];
+
+        unsigned int padding[2];
+    };
+
+    /**
+     * Turn the subtree of the binary hierarchy below an interior node into
+     * nodes of this one.
+     *
+     * @return Index of the node created for it.
+     */
+    unsigned int collapse(std::vector<Node> &nodes, const Bvh &bvh,
+                          unsigned int binary_index);
+
+    /**
+     * Test a ray against the four children of a node.
+     *
+     * @param t_near Set to the distance at which the ray enters each child.
+     * @return Bit i is set if the ray passes through child i between t_min
+     *         and t_max.
+     */
+    static inline int intersect_children(const Node &node,
+                                         const float origin[3],
+                                         const float inverse_direction[3],
+                                         float t_min, float t_max,
+                                         float t_near[WIDTH]);
+
+    void clear();
+
+    Node *m_nodes;
+    unsigned int m_node_count;
+
+    BoundingBox m_bounds;
+
+    // The shapes in the order of the leaves, compiled for them to test.
+    GeometryStore m_geometry;
+
+    // Not copyable, as it owns its nodes
+    Qbvh(const Qbvh&);
+    Qbvh &operator=(const Qbvh&);
+
+};  // class Qbvh
+
+}   // namespace RadRt
+
+#endif // QBVH_H_INCLUDED
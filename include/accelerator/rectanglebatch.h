@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef RECTANGLEBATCH_H_INCLUDED
+#define RECTANGLEBATCH_H_INCLUDED
+
+#include "shape.h"
+
+#include <vector>
+
+namespace RadRt
+{
+
+class Intersection;
+class Ray;
+class Rectangle;
+
+/**
+ * Rectangles stored back to back, one array per component of their plane
+ * and edge data, so that a ray is tested against four of them at once with
+ * SSE instructions.
+ */
+class RectangleBatch
+{
+public:
+
+    RectangleBatch() {};
+    ~RectangleBatch() {};
+
+    void assign(const std::vector<Rectangle*> &rectangles);
+
+    /**
+     * Read the rectangles again after they have moved.
+     */
+    void update();
+
+    void clear();
+
+    unsigned int size() const { return m_rectangles.size(); };
+
+    /**
+     * Find the closest intersection of a ray with a range of the rectangles.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param begin First rectangle to test.
+     * @param end Rectangle after the last one to test.
+     * @param hit Set to the closest intersection; left untouched if the ray
+     *        hits none of the rectangles.
+     * @return True if the ray hits one of the rectangles.
+     */
+    bool intersect(const Ray &ray, unsigned int begin, unsigned int end,
+                   Intersection &hit) const;
+
+    /**
+     * Test whether a range of the rectangles blocks a ray, the way
+     * Shape::occludes does for each of them.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param begin First rectangle to test.
+     * @param end Rectangle after the last one to test.
+     * @param origin Shape the ray leaves from, which is ignored; may be
+     *        null.
+     * @param transmission Multiplied by the transmissive constant of each
+     *        transparent rectangle the ray passes through.
+     * @return True if an opaque rectangle blocks the ray.
+     */
+    bool occluded(const Ray &ray, unsigned int begin, unsigned int end,
+                  const Shape *origin, float &transmission) const;
+
+private:
+
+    // Entries past the last rectangle, so that every group of four starting
+    // at a rectangle can be loaded
+    static const unsigned int PADDING = 3;
+
+    /**
+     * Intersect a ray with the four rectangles starting at some index.
+     *
+     * @return A mask of the rectangles before end hit within the ray interval,
+     *         closer than t_max; the distances are written to t.
+     */
+    int test(const Ray &ray, unsigned int index, unsigned int end,
+             float t_max, float t[4]) const;
+
+    std::vector<Rectangle*> m_rectangles;
+
+    std::vector<float> m_normal_x;
+    std::vector<float> m_normal_y;
+    std::vector<float> m_normal_z;
+    std::vector<float> m_plane_offset;
+    std::vector<float> m_corner_x;
+    std::vector<float> m_corner_y;
+    std::vector<float> m_corner_z;
+    std::vector<float> m_edge_u_x;
+    std::vector<float> m_edge_u_y;
+    std::vector<float> m_edge_u_z;
+    std::vector<float> m_edge_v_x;
+    std::vector<float> m_edge_v_y;
+    std::vector<float> m_edge_v_z;
+
+};  // class RectangleBatch
+
+}   // namespace RadRt
+
+#endif // RECTANGLEBATCH_H_INCLUDED
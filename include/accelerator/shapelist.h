@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef SHAPELIST_H_INCLUDED
+#define SHAPELIST_H_INCLUDED
+
+#include "accelerator.h"
+#include "geometrystore.h"
+
+namespace RadRt
+{
+
+/**
+ * The trivial accelerator: every query tests every shape. Useful as a
+ * reference, and for scenes with only a handful of shapes where building
+ * anything more elaborate does not pay off.
+ */
+class ShapeList : public Accelerator
+{
+public:
+
+    ShapeList() {};
+    ~ShapeList() {};
+
+    void build(const std::vector<Shape*> &shapes);
+
+    bool closest_intersection(const Ray &ray, Intersection &hit) const;
+
+    bool occluded(const Ray &ray, const Intersection *origin,
+                  float &transmission) const;
+
+    BoundingBox bounds() const { return m_bounds; };
+
+private:
+
+    // Shape and primitive within it of each entry of the list
+    std::vector<Shape*> m_shapes;
+    std::vector<unsigned int> m_primitives;
+
+    GeometryStore m_geometry;
+    BoundingBox m_bounds;
+
+};  // class ShapeList
+
+}   // namespace RadRt
+
+#endif // SHAPELIST_H_INCLUDED
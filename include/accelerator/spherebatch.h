@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef SPHEREBATCH_H_INCLUDED
+#define SPHEREBATCH_H_INCLUDED
+
+#include "shape.h"
+
+#include <vector>
+
+namespace RadRt
+{
+
+class Intersection;
+class Ray;
+class Sphere;
+
+/**
+ * Spheres stored back to back, one array per coordinate, so that a ray is
+ * tested against four of them at once with SSE instructions.
+ */
+class SphereBatch
+{
+public:
+
+    SphereBatch() {};
+    ~SphereBatch() {};
+
+    void assign(const std::vector<Sphere*> &spheres);
+
+    /**
+     * Read the spheres again after they have moved.
+     */
+    void update();
+
+    void clear();
+
+    unsigned int size() const { return m_spheres.size(); };
+
+    /**
+     * Find the closest intersection of a ray with a range of the spheres.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param begin First sphere to test.
+     * @param end Sphere after the last one to test.
+     * @param hit Set to the closest intersection; left untouched if the ray
+     *        hits none of the spheres.
+     * @return True if the ray hits one of the spheres.
+     */
+    bool intersect(const Ray &ray, unsigned int begin, unsigned int end,
+                   Intersection &hit) const;
+
+    /**
+     * Test whether a range of the spheres blocks a ray, the way
+     * Shape::occludes does for each of them.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param begin First sphere to test.
+     * @param end Sphere after the last one to test.
+     * @param origin Shape the ray leaves from, which is ignored; may be
+     *        null.
+     * @param transmission Multiplied by the transmissive constant of each
+     *        transparent sphere the ray passes through.
+     * @return True if an opaque sphere blocks the ray.
+     */
+    bool occluded(const Ray &ray, unsigned int begin, unsigned int end,
+                  const Shape *origin, float &transmission) const;
+
+private:
+
+    // Entries past the last sphere, so that every group of four starting
+    // at a sphere can be loaded
+    static const unsigned int PADDING = 3;
+
+    /**
+     * Intersect a ray with the four spheres starting at some index.
+     *
+     * @return A mask of the spheres before end hit within the ray interval,
+     *         closer than t_max; the distances are written to t.
+     */
+    int test(const Ray &ray, unsigned int index, unsigned int end,
+             float t_max, float t[4]) const;
+
+    std::vector<Sphere*> m_spheres;
+
+    std::vector<float> m_center_x;
+    std::vector<float> m_center_y;
+    std::vector<float> m_center_z;
+    std::vector<float> m_radius_squared;
+
+};  // class SphereBatch
+
+}   // namespace RadRt
+
+#endif // SPHEREBATCH_H_INCLUDED
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef TRIANGLEBATCH_H_INCLUDED
+#define TRIANGLEBATCH_H_INCLUDED
+
+#include "shape.h"
+
+#include <vector>
+
+namespace RadRt
+{
+
+class Intersection;
+class Mesh;
+class Ray;
+
+/**
+ * Triangles of meshes stored back to back, one array per component of a
+ * corner and the two edges leaving it, so that a ray is tested against four
+ * of them at once with SSE instructions.
+ */
+class TriangleBatch
+{
+public:
+
+    TriangleBatch() {};
+    ~TriangleBatch() {};
+
+    /**
+     * Gather triangles of meshes.
+     *
+     * @param meshes Mesh of each triangle.
+     * @param triangles Index of each triangle within its mesh.
+     */
+    void assign(const std::vector<Mesh*> &meshes,
+                const std::vector<unsigned int> &triangles);
+
+    /**
+     * Read the triangles again after they have moved.
+     */
+    void update();
+
+    void clear();
+
+    unsigned int size() const { return m_meshes.size(); };
+
+    /**
+     * Find the closest intersection of a ray with a range of the triangles.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param begin First triangle to test.
+     * @param end Triangle after the last one to test.
+     * @param hit Set to the closest intersection; left untouched if the ray
+     *        hits none of the triangles.
+     * @return True if the ray hits one of the triangles.
+     */
+    bool intersect(const Ray &ray, unsigned int begin, unsigned int end,
+                   Intersection &hit) const;
+
+    /**
+     * Test whether a range of the triangles blocks a ray, the way
+     * Mesh::occludes does for each of them.
+     *
+     * @param ray Ray to trace. Only intersections within its interval are
+     *        considered.
+     * @param begin First triangle to test.
+     * @param end Triangle after the last one to test.
+     * @param transmission Multiplied by the transmissive constant of each
+     *        transparent triangle the ray passes through.
+     * @return True if an opaque triangle blocks the ray.
+     */
+    bool occluded(const Ray &ray, unsigned int begin, unsigned int end,
+                  float &transmission) const;
+
+private:
+
+    // Entries past the last triangle, so that every group of four starting
+    // at a triangle can be loaded
+    static const unsigned int PADDING = 3;
+
+    /**
+     * Intersect a ray with the four triangles starting at some index.
+     *
+     * @return A mask of the triangles before end hit within the ray interval,
+     *         closer than t_max; the distances are written to t.
+     */
+    int test(const Ray &ray, unsigned int index, unsigned int end,
+             float t_max, float t[4]) const;
+
+    std::vector<Mesh*> m_meshes;
+    std::vector<unsigned int> m_triangles;
+
+    std::vector<float> m_corner_x;
+    std::vector<float> m_corner_y;
+    std::vector<float> m_corner_z;
+    std::vector<float> m_edge1_x;
+    std::vector<float> m_edge1_y;
+    std::vector<float> m_edge1_z;
+    std::vector<float> m_edge2_x;
+    std::vector<float> m_edge2_y;
+    std::vector<float> m_edge2_z;
+
+};  // class TriangleBatch
+
+}   // namespace RadRt
+
+#endif // TRIANGLEBATCH_H_INCLUDED
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+#include "json.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace RadRt
+{
+
+class Shape;
+
+/**
+ * Linear congruential generator, so that the scenes and rays of the
+ * benchmarks do not depend on the standard library's random number engines.
+ */
+class SceneRandom
+{
+public:
+
+    explicit SceneRandom(uint64_t seed): m_state(seed) {};
+
+    /**
+     * Get a number from 0 up to 1.
+     */
+    float next()
+    {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return float(m_state >> 40) / float(1 << 24);
+    }
+
+private:
+
+    uint64_t m_state;
+};
+
+/**
+ * Read and parse a scene file.
+ *
+ * @param filename File to read.
+ * @param root Set to the parsed scene.
+ * @return Whether the file was read; errors are reported on std::cerr.
+ */
+bool read_scene_json(const std::string &filename, Json::Value &root);
+
+/**
+ * Build a scene of randomly placed spheres, the same for every call with the
+ * same arguments. The spheres fill a cube whose size grows with their
+ * number, so that the density, and the work per ray, stays about the same.
+ *
+ * @param sphere_count Number of spheres.
+ * @param accelerator Accelerator type of the scene.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ */
+Json::Value sphere_scene_json(unsigned int sphere_count,
+                              const std::string &accelerator,
+                              int width = 320, int height = 240);
+
+/**
+ * Make the spheres of sphere_scene_json one at a time, without a scene or
+ * its JSON, for benchmarks of structures over more spheres than those fit
+ * in memory.
+ *
+ * @param sphere_count Number of spheres.
+ * @return The spheres, owned by the caller.
+ */
+std::vector<Shape*> sphere_scene_shapes(unsigned int sphere_count);
+
+/**
+ * Get the milliseconds elapsed since a point in time.
+ */
+inline double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Silences std::cout for as long as it lives, so that what the raytracer
+ * and the accelerators log does not break up the table a benchmark prints.
+ * Benchmarks print through report(), which stays connected.
+ */
+class QuietOutput
+{
+public:
+
+    QuietOutput();
+    ~QuietOutput();
+
+    /**
+     * Get a stream to the original std::cout.
+     */
+    std::ostream &report() { return m_report; };
+
+private:
+
+    QuietOutput(const QuietOutput &);
+    QuietOutput &operator=(const QuietOutput &);
+
+    std::streambuf *m_buffer;
+    std::ostream m_report;
+};
+
+}   // namespace RadRt
+
+#endif // BENCHMARK_H_INCLUDED
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef BOUNDINGBOX_H_INCLUDED
+#define BOUNDINGBOX_H_INCLUDED
+
+#include "point3d.h"
+#include "ray.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace RadRt
+{
+
+/**
+ * An axis-aligned box in world space. A default constructed box is empty:
+ * its minimum corner is at positive infinity and its maximum corner at
+ * negative infinity, so that growing it by any point or box yields exactly
+ * that point or box.
+ */
+class BoundingBox
+{
+public:
+
+    BoundingBox():
+        m_min(std::numeric_limits<float>::max(),
+              std::numeric_limits<float>::max(),
+              std::numeric_limits<float>::max()),
+        m_max(-std::numeric_limits<float>::max(),
+              -std::numeric_limits<float>::max(),
+              -std::numeric_limits<float>::max())
+    {
+    }
+
+    BoundingBox(const Point3d &min, const Point3d &max):
+        m_min(min),
+        m_max(max)
+    {
+    }
+
+    const Point3d &min() const { return m_min; };
+    const Point3d &max() const { return m_max; };
+
+    bool is_empty() const { return m_min.x_coord() > m_max.x_coord(); };
+
+    /**
+     * Get the lower bound of the box along an axis.
+     *
+     * @param axis 0, 1 or 2 for the x, y or z axis.
+     */
+    float min(int axis) const { return coordinate(m_min, axis); };
+
+    /**
+     * Get the upper bound of the box along an axis.
+     *
+     * @param axis 0, 1 or 2 for the x, y or z axis.
+     */
+    float max(int axis) const { return coordinate(m_max, axis); };
+
+    /**
+     * Get the center point of the box.
+     */
+    Point3d centroid() const
+    {
+        return Point3d((m_min.x_coord() + m_max.x_coord()) * 0.5f,
+                       (m_min.y_coord() + m_max.y_coord()) * 0.5f,
+                       (m_min.z_coord() + m_max.z_coord()) * 0.5f);
+    }
+
+    /**
+     * Get the surface area of the box. Empty boxes have no area.
+     */
+    float surface_area() const
+    {
+        if (is_empty())
+        {
+            return 0;
+        }
+
+        float dx = m_max.x_coord() - m_min.x_coord();
+        float dy = m_max.y_coord() - m_min.y_coord();
+        float dz = m_max.z_coord() - m_min.z_coord();
+        return 2 * (dx * dy + dy * dz + dz * dx);
+    }
+
+    /**
+     * Get the axis along which the box is the longest.
+     */
+    int longest_axis() const
+    {
+        float dx = m_max.x_coord() - m_min.x_coord();
+        float dy = m_max.y_coord() - m_min.y_coord();
+        float dz = m_max.z_coord() - m_min.z_coord();
+
+        if ((dx >= dy) && (dx >= dz))
+        {
+            return 0;
+        }
+        return (dy >= dz) ? 1 : 2;
+    }
+
+    /**
+     * Grow the box so that it contains a point.
+     *
+     * @param p Point to include.
+     */
+    void expand(const Point3d &p)
+    {
+        m_min = Point3d(std::min(m_min.x_coord(), p.x_coord()),
+                        std::min(m_min.y_coord(), p.y_coord()),
+                        std::min(m_min.z_coord(), p.z_coord()));
+        m_max = Point3d(std::max(m_max.x_coord(), p.x_coord()),
+                        std::max(m_max.y_coord(), p.y_coord()),
+                        std::max(m_max.z_coord(), p.z_coord()));
+    }
+
+    /**
+     * Grow the box so that it contains a second box.
+     *
+     * @param other Box to include.
+     */
+    void expand(const BoundingBox &other)
+    {
+        if (!other.is_empty())
+        {
+            expand(other.m_min);
+            expand(other.m_max);
+        }
+    }
+
+    /**
+     * Test whether a ray passes through the box using the slab method.
+     *
+     * @param ray Ray to test.
+     * @return True if the ray passes through the box within its interval.
+     */
+    bool intersects(const Ray &ray) const
+    {
+        float t_min = ray.t_min();
+        float t_max = ray.t_max();
+
+        const Point3d &origin = ray.vertex();
+        const Vector3d &direction = ray.direction();
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float inverse_direction = 1.0f /
+                ((axis == 0) ? direction.x_component() :
+                 (axis == 1) ? direction.y_component() :
+                               direction.z_component());
+            float t0 = (min(axis) - coordinate(origin, axis)) *
+                       inverse_direction;
+            float t1 = (max(axis) - coordinate(origin, axis)) *
+                       inverse_direction;
+
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
+
+            t_min = std::max(t_min, t0);
+            t_max = std::min(t_max, t1);
+
+            if (t_min > t_max)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+
+    static float coordinate(const Point3d &p, int axis)
+    {
+        return (axis == 0) ? p.x_coord() :
+               (axis == 1) ? p.y_coord() : p.z_coord();
+    }
+
+    Point3d m_min;
+    Point3d m_max;
+};
+
+}   // namespace RadRt
+
+#endif // BOUNDINGBOX_H_INCLUDED
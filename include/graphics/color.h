@@ -17,12 +17,12 @@
 
 #include <iostream>
 
-#include "ijsonserializable.h"
+#include "float4.h"
 
 namespace RadRt
 {
 
-class Color : public IJsonSerializable
+class Color
 {
 public:
 
@@ -33,44 +33,28 @@ public:
 	 * @param blue Blue component of the color.
 	 * @param green Green component of the color.
 	 */
-    Color(float red, float green, float blue);
-
-    /**
-     * Copy constructor.
-     *
-     * @param other Color to copy.
-     */
-    Color(const Color& other);
+    Color(float red, float green, float blue):
+        m_components(red, green, blue) {};
 
     /**
      * Create a default color object with the color black.
      */
-    Color();
-
-    /**
-     * Serialize this object to JSON format.
-     */
-    Json::Value serialize() const;
-
-    /**
-     * Deserialize this object from JSON format.
-     */
-    void deserialize(const Json::Value &root);
+    Color() {};
 
     /**
      * Get the red component of this color.
      */
-    float red() const { return m_red; };
+    float red() const { return m_components.x(); };
 
     /**
      * Get the green component of this color.
      */
-    float green() const { return m_green; };
+    float green() const { return m_components.y(); };
 
     /**
      * Get the blue component of this color.
      */
-    float blue() const { return m_blue; };
+    float blue() const { return m_components.z(); };
 
     /**
      * Reduce each color component to its maximum value if it falls outside the
@@ -85,7 +69,7 @@ public:
      *
      * @param other Second color to use.
      */
-    inline Color operator*(const Color& other);
+    inline Color operator*(const Color& other) const;
 
     /**
      * Create a new color by multipling the components of this color by a
@@ -93,7 +77,7 @@ public:
      *
      * @param scalar Scalar constant to use in the multiplication.
      */
-    inline Color operator*(float scalar);
+    inline Color operator*(float scalar) const;
 
     /**
      * Multiply the components of this color by a scalar constant.
@@ -108,7 +92,7 @@ public:
      *
      * @param scalar Scalar constant to use in the multiplication.
      */
-    inline Color operator/(float scalar);
+    inline Color operator/(float scalar) const;
 
     /**
      * Divide the components of this color by a scalar constant.
@@ -123,7 +107,7 @@ public:
      *
      * @param other Second color to use in the addition.
      */
-    inline Color operator+(const Color& other);
+    inline Color operator+(const Color& other) const;
 
     /**
      * Add the components of a second color to the corresponding components of
@@ -144,80 +128,62 @@ public:
 
 private:
 
-    float m_red;
-    float m_green;
-    float m_blue;
+    explicit Color(const Float4 &components): m_components(components) {};
+
+    Float4 m_components;
 
 };  // class Color
 
-inline Color Color::operator*(const Color& other)
+// One Float4 and no vtable pointer
+static_assert(sizeof(Color) == 16, "Color must be one Float4");
+
+inline Color Color::operator*(const Color& other) const
 {
-    return Color(m_red   * other.m_red,
-    			 m_green * other.m_green,
-    			 m_blue  * other.m_blue);
+    return Color(m_components * other.m_components);
 }
 
-inline Color Color::operator*(float scalar)
+inline Color Color::operator*(float scalar) const
 {
-    return Color(m_red * scalar, m_green * scalar, m_blue * scalar);
+    return Color(m_components * scalar);
 }
 
 inline Color& Color::operator*=(float scalar)
 {
-    m_red *= scalar;
-    m_green *= scalar;
-    m_blue *= scalar;
+    m_components = m_components * scalar;
     return *this;
 }
 
-inline Color Color::operator/(float scalar)
+inline Color Color::operator/(float scalar) const
 {
     if (scalar != 0)
-        return Color(m_red / scalar, m_green / scalar, m_blue / scalar);
+        return Color(m_components / scalar);
     else
-        return Color(m_red, m_green, m_blue);
+        return *this;
 }
 
 inline Color& Color::operator/=(float scalar)
 {
     if (scalar != 0)
     {
-        m_red /= scalar;
-        m_green /= scalar;
-        m_blue /= scalar;
+        m_components = m_components / scalar;
     }
     return *this;
 }
 
-inline Color Color::operator+(const Color& other)
+inline Color Color::operator+(const Color& other) const
 {
-    return Color(m_red   + other.m_red,
-    			 m_green + other.m_green,
-    			 m_blue  + other.m_blue);
+    return Color(m_components + other.m_components);
 }
 
 inline Color& Color::operator+=(const Color& other)
 {
-    m_red += other.m_red;
-    m_green += other.m_green;
-    m_blue += other.m_blue;
+    m_components = m_components + other.m_components;
     return *this;
 }
 
 inline void Color::clamp()
 {
-    if (m_red > 1.0)
-    {
-        m_red = 1.0;
-    }
-    if (m_green > 1.0)
-    {
-        m_green = 1.0;
-    }
-    if (m_blue > 1.0)
-    {
-        m_blue = 1.0;
-    }
+    m_components = min(m_components, Float4(1, 1, 1, 1));
 }
 
 }   // namespace RadRt
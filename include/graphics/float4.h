@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef FLOAT4_H_INCLUDED
+#define FLOAT4_H_INCLUDED
+
+#include <cmath>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace RadRt
+{
+
+/**
+ * Four floats operated on together, held in an SSE register where the
+ * target has one and in an aligned array otherwise. Vector3d, Point3d and
+ * Color keep their components in the first three lanes and zero in the
+ * fourth.
+ *
+ * Every operation rounds each lane exactly as the same scalar expression
+ * would, so results do not depend on whether SSE is used.
+ */
+class Float4
+{
+public:
+
+    Float4()
+    {
+#ifdef __SSE__
+        m_lanes = _mm_setzero_ps();
+#else
+        m_lanes[0] = m_lanes[1] = m_lanes[2] = m_lanes[3] = 0;
+#endif
+    };
+
+    Float4(float x, float y, float z, float w = 0)
+    {
+#ifdef __SSE__
+        m_lanes = _mm_set_ps(w, z, y, x);
+#else
+        m_lanes[0] = x;
+        m_lanes[1] = y;
+        m_lanes[2] = z;
+        m_lanes[3] = w;
+#endif
+    };
+
+#ifdef __SSE__
+    float x() const { return _mm_cvtss_f32(m_lanes); };
+    float y() const { return _mm_cvtss_f32(broadcast<1>()); };
+    float z() const { return _mm_cvtss_f32(broadcast<2>()); };
+#else
+    float x() const { return m_lanes[0]; };
+    float y() const { return m_lanes[1]; };
+    float z() const { return m_lanes[2]; };
+#endif
+
+    friend inline Float4 operator+(const Float4 &a, const Float4 &b)
+    {
+#ifdef __SSE__
+        return Float4(_mm_add_ps(a.m_lanes, b.m_lanes));
+#else
+        return Float4(a.m_lanes[0] + b.m_lanes[0], a.m_lanes[1] + b.m_lanes[1],
+                      a.m_lanes[2] + b.m_lanes[2], a.m_lanes[3] + b.m_lanes[3]);
+#endif
+    }
+
+    friend inline Float4 operator-(const Float4 &a, const Float4 &b)
+    {
+#ifdef __SSE__
+        return Float4(_mm_sub_ps(a.m_lanes, b.m_lanes));
+#else
+        return Float4(a.m_lanes[0] - b.m_lanes[0], a.m_lanes[1] - b.m_lanes[1],
+                      a.m_lanes[2] - b.m_lanes[2], a.m_lanes[3] - b.m_lanes[3]);
+#endif
+    }
+
+    friend inline Float4 operator*(const Float4 &a, const Float4 &b)
+    {
+#ifdef __SSE__
+        return Float4(_mm_mul_ps(a.m_lanes, b.m_lanes));
+#else
+        return Float4(a.m_lanes[0] * b.m_lanes[0], a.m_lanes[1] * b.m_lanes[1],
+                      a.m_lanes[2] * b.m_lanes[2], a.m_lanes[3] * b.m_lanes[3]);
+#endif
+    }
+
+    friend inline Float4 operator*(const Float4 &a, float s)
+    {
+#ifdef __SSE__
+        return Float4(_mm_mul_ps(a.m_lanes, _mm_set1_ps(s)));
+#else
+        return Float4(a.m_lanes[0] * s, a.m_lanes[1] * s, a.m_lanes[2] * s,
+                      a.m_lanes[3] * s);
+#endif
+    }
+
+    friend inline Float4 operator/(const Float4 &a, float s)
+    {
+#ifdef __SSE__
+        return Float4(_mm_div_ps(a.m_lanes, _mm_set1_ps(s)));
+#else
+        return Float4(a.m_lanes[0] / s, a.m_lanes[1] / s, a.m_lanes[2] / s,
+                      a.m_lanes[3] / s);
+#endif
+    }
+
+    friend inline Float4 operator-(const Float4 &a)
+    {
+#ifdef __SSE__
+        return Float4(_mm_xor_ps(a.m_lanes, _mm_set1_ps(-0.0f)));
+#else
+        return Float4(-a.m_lanes[0], -a.m_lanes[1], -a.m_lanes[2],
+                      -a.m_lanes[3]);
+#endif
+    }
+
+    /**
+     * Take each lane of the first operand unless the second is smaller,
+     * so that a NaN in the first operand is kept.
+     */
+    friend inline Float4 min(const Float4 &a, const Float4 &b)
+    {
+#ifdef __SSE__
+        return Float4(_mm_min_ps(b.m_lanes, a.m_lanes));
+#else
+        Float4 result;
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            result.m_lanes[lane] = (b.m_lanes[lane] < a.m_lanes[lane]) ?
+                                   b.m_lanes[lane] : a.m_lanes[lane];
+        }
+        return result;
+#endif
+    }
+
+    /**
+     * Dot product of the first three lanes, summed as (x + y) + z.
+     */
+    friend inline float dot3(const Float4 &a, const Float4 &b)
+    {
+#ifdef __SSE__
+        Float4 product(_mm_mul_ps(a.m_lanes, b.m_lanes));
+        return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(product.m_lanes,
+                                                   product.broadcast<1>()),
+                                        product.broadcast<2>()));
+#else
+        return (a.m_lanes[0] * b.m_lanes[0] + a.m_lanes[1] * b.m_lanes[1]) +
+               a.m_lanes[2] * b.m_lanes[2];
+#endif
+    }
+
+    /**
+     * Cross product of the first three lanes, with zero in the fourth.
+     */
+    friend inline Float4 cross3(const Float4 &a, const Float4 &b)
+    {
+#ifdef __SSE__
+        __m128 a_yzx = _mm_shuffle_ps(a.m_lanes, a.m_lanes,
+                                      _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 b_yzx = _mm_shuffle_ps(b.m_lanes, b.m_lanes,
+                                      _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 a_zxy = _mm_shuffle_ps(a.m_lanes, a.m_lanes,
+                                      _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 b_zxy = _mm_shuffle_ps(b.m_lanes, b.m_lanes,
+                                      _MM_SHUFFLE(3, 1, 0, 2));
+        return Float4(_mm_sub_ps(_mm_mul_ps(a_yzx, b_zxy),
+                                 _mm_mul_ps(a_zxy, b_yzx)));
+#else
+        const float *u = a.m_lanes;
+        const float *v = b.m_lanes;
+        return Float4(u[1] * v[2] - u[2] * v[1],
+                      u[2] * v[0] - u[0] * v[2],
+                      u[0] * v[1] - u[1] * v[0]);
+#endif
+    }
+
+private:
+
+#ifdef __SSE__
+    explicit Float4(__m128 lanes): m_lanes(lanes) {};
+
+    template <int lane>
+    __m128 broadcast() const
+    {
+        return _mm_shuffle_ps(m_lanes, m_lanes,
+                              _MM_SHUFFLE(lane, lane, lane, lane));
+    }
+
+    __m128 m_lanes;
+#else
+    alignas(16) float m_lanes[4];
+#endif
+};
+
+static_assert(sizeof(Float4) == 16, "Float4 must fill one SSE register");
+
+}   // namespace RadRt
+
+#endif // FLOAT4_H_INCLUDED
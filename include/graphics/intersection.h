@@ -10,33 +10,64 @@
 #include "shape.h"
 #include "vector3d.h"
 
+#include <limits>
+
 namespace RadRt
 {
 
+/**
+ * Where a ray hits a shape. Filled in by intersection queries, which leave
+ * it untouched when the ray hits nothing, so that it can live on the stack
+ * of the caller.
+ */
 class Intersection
 {
 public:
 
-    Intersection(Point3d intersection_point,
+    Intersection():
+        m_t(std::numeric_limits<float>::max()),
+        m_intersected_shape(nullptr),
+        m_instance(nullptr)
+    {
+    }
+
+    Intersection(float t,
+                 Point3d intersection_point,
                  Vector3d normal,
-                 Shape *intersected_shape):
+                 const Shape *intersected_shape,
+                 const Shape *instance = nullptr):
+        m_t(t),
         m_intersection_point(intersection_point),
         m_normal(normal),
-        m_intersected_shape(intersected_shape)
+        m_intersected_shape(intersected_shape),
+        m_instance(instance)
     {
     }
 
+    // Distance along the ray to the intersection point, in units of the ray
+    // direction
+    float t() const { return this->m_t; };
+
     Point3d intersection_point() const { return this->m_intersection_point; };
     Vector3d normal() const { return this->m_normal; };
-    Shape *intersected_shape() const { return this->m_intersected_shape; };
+    const Shape *intersected_shape() const
+    {
+        return this->m_intersected_shape;
+    };
+
+    // The instance placing the intersected shape, or nullptr if the shape
+    // is placed in the scene directly
+    const Shape *instance() const { return this->m_instance; };
 
     void set_normal(Vector3d normal) { this->m_normal = normal; };
 
 private:
 
+    float m_t;
     Point3d m_intersection_point;
     Vector3d m_normal;
-    Shape *m_intersected_shape;
+    const Shape *m_intersected_shape;
+    const Shape *m_instance;
 };
 
 }
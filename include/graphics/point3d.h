@@ -6,10 +6,8 @@
 #ifndef POINT_H
 #define POINT_H
 
+#include "float4.h"
 #include "vector3d.h"
-#include "color.h"
-
-#include <ijsonserializable.h>
 
 namespace RadRt
 {
@@ -18,18 +16,22 @@ class Point3d
 {
     friend inline float distance_between(const Point3d &p1, const Point3d &p2)
     {
-        float dx = p1.m_x_coord - p2.m_x_coord;
-        float dy = p1.m_y_coord - p2.m_y_coord;
-        float dz = p1.m_z_coord - p2.m_z_coord;
-
-        return sqrt((dx*dx) + (dy*dy) + (dz*dz));
+        return length(p1 - p2);
     }
 
     friend inline Vector3d displacement_vector(const Point3d &p1, const Point3d &p2)
     {
-        return Vector3d(p1.m_x_coord - p2.m_x_coord,
-        		      p1.m_y_coord - p2.m_y_coord,
-        		      p1.m_z_coord - p2.m_z_coord);
+        return p1 - p2;
+    }
+
+    friend inline Vector3d operator-(const Point3d &p1, const Point3d &p2)
+    {
+        return Vector3d(p1.m_coords - p2.m_coords);
+    }
+
+    friend inline Point3d operator+(const Point3d &p, const Vector3d &v)
+    {
+        return Point3d(p.m_coords + v.components());
     }
 
 public:
@@ -44,29 +46,30 @@ public:
     /// @param y - y-axis component of constructed point
     /// @param z - z-axis component of constructed point
     ///
-    Point3d(float x, float y, float z);
+    Point3d(float x, float y, float z): m_coords(x, y, z) {};
 
     ///
     /// @name Point
     ///
     /// @description
-    /// 	Constructor
+    /// 	Constructor from packed coordinates, with zero in the last lane
     ///
-    /// @param p - starting point
-    /// @param v - direction vector
-    /// @param distance - distance along direction vector
+    /// @param coords - x, y and z coordinates of constructed point
     ///
-    Point3d(const Point3d& p, const Vector3d& v, const float& distance);
+    explicit Point3d(const Float4 &coords): m_coords(coords) {};
 
     ///
     /// @name Point
     ///
     /// @description
-    /// 	Copy Constructor
+    /// 	Constructor
     ///
-    /// @param other - Point object to copy
+    /// @param p - starting point
+    /// @param v - direction vector
+    /// @param distance - distance along direction vector
     ///
-    Point3d(const Point3d& other);
+    Point3d(const Point3d& p, const Vector3d& v, const float& distance):
+        m_coords(p.m_coords + v.components() * distance) {};
 
     ///
     /// @name Point
@@ -74,25 +77,23 @@ public:
     /// @description
     /// 	Default Constructor
     ///
-    Point3d();
+    Point3d() {};
 
-    ~Point3d() {};
+    float x_coord() const { return m_coords.x(); };
+    float y_coord() const { return m_coords.y(); };
+    float z_coord() const { return m_coords.z(); };
 
-    float x_coord() const { return m_x_coord; };
-    float y_coord() const { return m_y_coord; };
-    float z_coord() const { return m_z_coord; };
-
-    Json::Value serialize() const;
-    void deserialize(const Json::Value &root);
+    const Float4 &coords() const { return m_coords; };
 
 private:
 
-    float m_x_coord;
-    float m_y_coord;
-    float m_z_coord;
+    Float4 m_coords;
 
 };  // class Point
 
+// One Float4 and no vtable pointer
+static_assert(sizeof(Point3d) == 16, "Point3d must be one Float4");
+
 }   // namespace RadRt
 
 #endif
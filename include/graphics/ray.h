@@ -9,28 +9,58 @@
 #include "point3d.h"
 #include "vector3d.h"
 
+#include <limits>
+
 namespace RadRt
 {
 
+/**
+ * Distance at which rays leaving a surface start, so that rounding errors
+ * in the intersection point do not make them hit that surface again.
+ */
+const float SURFACE_OFFSET = 0.01f;
+
+/**
+ * A half-line together with the interval of distances along it that
+ * intersection queries consider. Distances are in units of the direction.
+ */
 class Ray
 {
 public:
 
-    Ray(Point3d vertex, Vector3d direction):
-        m_vertex(vertex), m_direction(direction) {}
+    Ray(): m_t_min(0), m_t_max(std::numeric_limits<float>::max()) {}
+
+    Ray(Point3d vertex, Vector3d direction,
+        float t_min = 0, float t_max = std::numeric_limits<float>::max()):
+        m_vertex(vertex), m_direction(direction),
+        m_t_min(t_min), m_t_max(t_max) {}
 
     Point3d vertex() const { return m_vertex; };
     Vector3d direction() const { return m_direction; };
 
+    float t_min() const { return m_t_min; };
+    float t_max() const { return m_t_max; };
+
+    /**
+     * Test whether a distance lies within the interval of the ray.
+     */
+    bool contains(float t) const { return (t >= m_t_min) && (t <= m_t_max); };
+
     void set_vertex(Point3d vertex) { this->m_vertex = vertex; };
     void set_direction(Vector3d direction) { this->m_direction = direction; };
+    void set_t_max(float t_max) { this->m_t_max = t_max; };
 
 private:
 
     Point3d m_vertex;
     Vector3d m_direction;
+    float m_t_min;
+    float m_t_max;
 };
 
+// A vertex, a direction and the interval, padded to the alignment of Float4
+static_assert(sizeof(Ray) == 48, "Ray must be three Float4s");
+
 }   // namespace RadRt
 
 #endif // RAY_H_INCLUDED
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef RAYPACKET_H_INCLUDED
+#define RAYPACKET_H_INCLUDED
+
+#include "ray.h"
+
+#include <vector>
+
+namespace RadRt
+{
+
+/**
+ * A group of rays traced together, such as the primary rays of a square of
+ * neighboring pixels. Rays that start at the same point and head in nearly
+ * the same direction visit nearly the same parts of an acceleration
+ * structure, so the structure can be walked once for all of them.
+ */
+class RayPacket
+{
+public:
+
+    /**
+     * Largest number of rays in a packet, that of an 8x8 square of pixels.
+     */
+    static const int MAX_SIZE = 64;
+
+    RayPacket() { m_rays.reserve(MAX_SIZE); };
+
+    /**
+     * Append a ray, if the packet is not yet full.
+     *
+     * @return True if the ray was added.
+     */
+    bool add(const Ray &ray)
+    {
+        if (size() >= MAX_SIZE)
+        {
+            return false;
+        }
+        m_rays.push_back(ray);
+        return true;
+    };
+
+    /**
+     * Remove all rays, keeping the storage for the next packet.
+     */
+    void clear() { m_rays.clear(); };
+
+    int size() const { return m_rays.size(); };
+    const Ray &ray(int index) const { return m_rays[index]; };
+
+private:
+
+    std::vector<Ray> m_rays;
+};
+
+}   // namespace RadRt
+
+#endif // RAYPACKET_H_INCLUDED
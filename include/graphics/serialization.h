@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef SERIALIZATION_H_INCLUDED
+#define SERIALIZATION_H_INCLUDED
+
+#include "color.h"
+#include "point3d.h"
+#include "vector3d.h"
+
+#include "json.h"
+
+namespace RadRt
+{
+
+/**
+ * Conversions between the math types and JSON. They are free functions so
+ * that the math types stay plain values, without the vtable pointer of
+ * IJsonSerializable.
+ *
+ * Vectors and points are written as {"x", "y", "z"} and colors as
+ * {"r", "g", "b"}.
+ */
+
+Json::Value to_json(const Vector3d &vector);
+Json::Value to_json(const Point3d &point);
+Json::Value to_json(const Color &color);
+
+void from_json(const Json::Value &root, Vector3d &vector);
+void from_json(const Json::Value &root, Point3d &point);
+void from_json(const Json::Value &root, Color &color);
+
+}   // namespace RadRt
+
+#endif // SERIALIZATION_H_INCLUDED
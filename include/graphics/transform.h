@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef TRANSFORM_H_INCLUDED
+#define TRANSFORM_H_INCLUDED
+
+#include "boundingbox.h"
+#include "point3d.h"
+#include "vector3d.h"
+
+#include <math.h>
+
+namespace RadRt
+{
+
+/**
+ * An affine transform: a linear map followed by a translation, stored as
+ * the top three rows of a 4x4 matrix.
+ */
+class Transform
+{
+
+    /**
+     * Combine two transforms into one that applies inner first, then outer.
+     */
+    friend inline Transform compose(const Transform &outer,
+                                    const Transform &inner)
+    {
+        Transform result;
+        for (int row = 0; row < 3; ++row)
+        {
+            for (int column = 0; column < 4; ++column)
+            {
+                float sum = (column == 3) ? outer.m[row][3] : 0;
+                for (int k = 0; k < 3; ++k)
+                {
+                    sum += outer.m[row][k] * inner.m[k][column];
+                }
+                result.m[row][column] = sum;
+            }
+        }
+        return result;
+    }
+
+public:
+
+    /**
+     * Create the identity transform.
+     */
+    Transform()
+    {
+        for (int row = 0; row < 3; ++row)
+        {
+            for (int column = 0; column < 4; ++column)
+            {
+                m[row][column] = (row == column) ? 1 : 0;
+            }
+        }
+    }
+
+    static Transform translation(const Vector3d &offset)
+    {
+        Transform result;
+        result.m[0][3] = offset.x_component();
+        result.m[1][3] = offset.y_component();
+        result.m[2][3] = offset.z_component();
+        return result;
+    }
+
+    static Transform scale(const Vector3d &factors)
+    {
+        Transform result;
+        result.m[0][0] = factors.x_component();
+        result.m[1][1] = factors.y_component();
+        result.m[2][2] = factors.z_component();
+        return result;
+    }
+
+    /**
+     * Create a rotation about an axis through the origin.
+     *
+     * @param axis Axis of rotation; need not be normalized.
+     * @param degrees Counterclockwise angle when looking down the axis.
+     */
+    static Transform rotation(const Vector3d &axis, float degrees)
+    {
+        Vector3d u = normalize(axis);
+        float x = u.x_component();
+        float y = u.y_component();
+        float z = u.z_component();
+
+        float radians = degrees * M_PI / 180.0;
+        float c = cos(radians);
+        float s = sin(radians);
+        float t = 1 - c;
+
+        Transform result;
+        result.m[0][0] = t * x * x + c;
+        result.m[0][1] = t * x * y - s * z;
+        result.m[0][2] = t * x * z + s * y;
+        result.m[1][0] = t * x * y + s * z;
+        result.m[1][1] = t * y * y + c;
+        result.m[1][2] = t * y * z - s * x;
+        result.m[2][0] = t * x * z - s * y;
+        result.m[2][1] = t * y * z + s * x;
+        result.m[2][2] = t * z * z + c;
+        return result;
+    }
+
+    /**
+     * Get the transform undoing this one. The linear part must not be
+     * singular.
+     */
+    Transform inverse() const
+    {
+        // Inverse of the linear part by cofactors
+        float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+        float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+        float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+        float inverse_determinant =
+            1.0f / (m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02);
+
+        Transform result;
+        result.m[0][0] = c00 * inverse_determinant;
+        result.m[1][0] = c01 * inverse_determinant;
+        result.m[2][0] = c02 * inverse_determinant;
+        result.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) *
+                         inverse_determinant;
+        result.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) *
+                         inverse_determinant;
+        result.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) *
+                         inverse_determinant;
+        result.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) *
+                         inverse_determinant;
+        result.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) *
+                         inverse_determinant;
+        result.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) *
+                         inverse_determinant;
+
+        // The translation moves back by the inverse-mapped offset
+        for (int row = 0; row < 3; ++row)
+        {
+            result.m[row][3] = -(result.m[row][0] * m[0][3] +
+                                 result.m[row][1] * m[1][3] +
+                                 result.m[row][2] * m[2][3]);
+        }
+        return result;
+    }
+
+    Point3d apply(const Point3d &p) const
+    {
+        float x = p.x_coord();
+        float y = p.y_coord();
+        float z = p.z_coord();
+        return Point3d(row(0, x, y, z) + m[0][3],
+                       row(1, x, y, z) + m[1][3],
+                       row(2, x, y, z) + m[2][3]);
+    }
+
+    /**
+     * Transform a direction, which is unaffected by the translation.
+     */
+    Vector3d apply(const Vector3d &v) const
+    {
+        float x = v.x_component();
+        float y = v.y_component();
+        float z = v.z_component();
+        return Vector3d(row(0, x, y, z), row(1, x, y, z), row(2, x, y, z));
+    }
+
+    /**
+     * Multiply a vector by the transpose of the linear part. Surface normals
+     * are carried through a transform by applying this to them on its
+     * inverse.
+     */
+    Vector3d apply_transposed(const Vector3d &v) const
+    {
+        float x = v.x_component();
+        float y = v.y_component();
+        float z = v.z_component();
+        return Vector3d(m[0][0] * x + m[1][0] * y + m[2][0] * z,
+                        m[0][1] * x + m[1][1] * y + m[2][1] * z,
+                        m[0][2] * x + m[1][2] * y + m[2][2] * z);
+    }
+
+    /**
+     * Get the smallest axis-aligned box containing a transformed box.
+     */
+    BoundingBox apply(const BoundingBox &box) const
+    {
+        BoundingBox result;
+        if (box.is_empty())
+        {
+            return result;
+        }
+
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            result.expand(apply(Point3d(
+                (corner & 1) ? box.max(0) : box.min(0),
+                (corner & 2) ? box.max(1) : box.min(1),
+                (corner & 4) ? box.max(2) : box.min(2))));
+        }
+        return result;
+    }
+
+private:
+
+    float row(int index, float x, float y, float z) const
+    {
+        return m[index][0] * x + m[index][1] * y + m[index][2] * z;
+    }
+
+    float m[3][4];
+};
+
+}   // namespace RadRt
+
+#endif // TRANSFORM_H_INCLUDED
@@ -9,68 +9,73 @@
 #include <math.h>
 #include <iostream>
 
-#include "ijsonserializable.h"
+#include "float4.h"
 
 namespace RadRt
 {
 
-class Vector3d : public IJsonSerializable
+class Vector3d
 {
 
+    friend inline Vector3d operator+(const Vector3d &a, const Vector3d &b)
+    {
+        return Vector3d(a.m_components + b.m_components);
+    }
+
+    friend inline Vector3d operator-(const Vector3d &a, const Vector3d &b)
+    {
+        return Vector3d(a.m_components - b.m_components);
+    }
+
+    friend inline Vector3d operator*(const Vector3d &v, float scalar)
+    {
+        return Vector3d(v.m_components * scalar);
+    }
+
+    friend inline Vector3d operator-(const Vector3d &v)
+    {
+        return Vector3d(-v.m_components);
+    }
+
     friend inline Vector3d vector_add(const Vector3d &a, const Vector3d &b)
     {
-        return Vector3d(a.m_x_component + b.m_x_component,
-        		      a.m_y_component + b.m_y_component,
-        		      a.m_z_component + b.m_z_component);
+        return a + b;
     }
 
     friend inline Vector3d normalize(const Vector3d &v)
     {
-        double s = 1.0 / length(v);
-        return Vector3d(v.m_x_component * s,
-        		      v.m_y_component * s,
-        		      v.m_z_component * s);
+        float s = 1.0f / length(v);
+        return v * s;
     }
 
     friend inline float length(const Vector3d &v)
     {
-        return (float) sqrt(v.m_x_component * v.m_x_component +
-        		            v.m_y_component * v.m_y_component +
-        		            v.m_z_component * v.m_z_component);
+        return std::sqrt(dot_product(v, v));
     }
 
     friend inline Vector3d scalar_multiply(const Vector3d &v, const float scalar)
     {
-        return Vector3d(v.m_x_component * scalar,
-        			  v.m_y_component * scalar,
-        			  v.m_z_component * scalar);
+        return v * scalar;
     }
 
     friend inline float dot_product(const Vector3d &v1, const Vector3d &v2)
     {
-        return ((v1.m_x_component * v2.m_x_component) +
-                (v1.m_y_component * v2.m_y_component) +
-                (v1.m_z_component * v2.m_z_component));
+        return dot3(v1.m_components, v2.m_components);
     }
 
     friend inline Vector3d cross_product(const Vector3d &v1, const Vector3d &v2)
     {
-        return Vector3d(v1.m_y_component * v2.m_z_component -
-        		      v1.m_z_component * v2.m_y_component,
-                      v1.m_z_component * v2.m_x_component -
-                      v1.m_x_component * v2.m_z_component,
-                      v1.m_x_component * v2.m_y_component -
-                      v1.m_y_component * v2.m_x_component);
+        return Vector3d(cross3(v1.m_components, v2.m_components));
     }
 
     friend inline Vector3d vector_subtract(const Vector3d &v1, const Vector3d &v2)
     {
-        return Vector3d(v1.m_x_component - v2.m_x_component, v1.m_y_component - v2.m_y_component, v1.m_z_component - v2.m_z_component);
+        return v1 - v2;
     }
 
     friend inline Vector3d negate_vector(const Vector3d &v)
     {
-        return Vector3d(-v.m_x_component, -v.m_y_component, -v.m_z_component);
+        return -v;
     }
 
 public:
@@ -85,39 +90,41 @@ public:
     /// @param y - y-axis component of this vector
     /// @param z - z-axis component of this vector
     ///
-    Vector3d(float x, float y, float z);
+    Vector3d(float x, float y, float z): m_components(x, y, z) {};
 
     ///
     /// @name Vector
     ///
     /// @description
-    /// 	Default constructor
+    /// 	Constructor from packed components, with zero in the last lane
     ///
-    Vector3d();
+    /// @param components - x, y and z components of this vector
+    ///
+    explicit Vector3d(const Float4 &components): m_components(components) {};
 
     ///
-    /// @name ~Vector
+    /// @name Vector
     ///
     /// @description
-    /// 	Destructor
+    /// 	Default constructor
     ///
-    ~Vector3d() {};
+    Vector3d() {};
 
-    Json::Value serialize() const;
-    void deserialize(const Json::Value &root);
+    inline float x_component() const { return m_components.x(); };
+    inline float y_component() const { return m_components.y(); };
+    inline float z_component() const { return m_components.z(); };
 
-    inline float x_component() const { return m_x_component; };
-    inline float y_component() const { return m_y_component; };
-    inline float z_component() const { return m_z_component; };
+    inline const Float4 &components() const { return m_components; };
 
 private:
 
-    float m_x_component;
-    float m_y_component;
-    float m_z_component;
+    Float4 m_components;
 
 };  // class Vector
 
+// One Float4 and no vtable pointer
+static_assert(sizeof(Vector3d) == 16, "Vector3d must be one Float4");
+
 }   // namespace RadRt
 
 #endif
@@ -32,6 +32,25 @@ public:
     void draw_image(Image *image);
     void clear();
 
+    /**
+     * Start drawing an image tile by tile, over a blank canvas of its size.
+     */
+    void start_image(int width, int height);
+
+    /**
+     * Draw part of the image started by start_image. Each pixel of the tile
+     * covers a square of pixels of the image, so that a tile of a lower
+     * resolution image stands in for the same area at full resolution.
+     * Tiles must not be drawn once clear or draw_image has replaced the
+     * image, as they no longer fit the canvas.
+     *
+     * @param tile Pixels of the tile.
+     * @param left First column of the image the tile covers.
+     * @param top First row of the image the tile covers.
+     * @param scale Side of the square of image pixels each tile pixel covers.
+     */
+    void draw_tile(const Image &tile, int left, int top, int scale);
+
 protected:
 
     virtual bool on_draw(const Cairo::RefPtr<Cairo::Context>& cr);
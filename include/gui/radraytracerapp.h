@@ -8,13 +8,20 @@
 
 #include "canvas.h"
 #include "image.h"
+#include "raytracer.h"
+#include "renderhandle.h"
+#include "scenesnapshot.h"
 
+#include <glibmm/dispatcher.h>
 #include <gtkmm/button.h>
 #include <gtkmm/window.h>
 #include <gtkmm/box.h>
 #include <gtkmm/label.h>
 #include <gtkmm/menu.h>
 #include <gtkmm/menubar.h>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace RadRt
 {
@@ -33,7 +40,12 @@ public:
     void save_scene(const char *filename);
     void open_scene(const char *filename);
 
-    void run_raytracer();
+    /**
+     * Trace a snapshot of the scene, coarsely first and then at full
+     * resolution, handing each finished tile to the main thread to draw.
+     * Runs on the render thread.
+     */
+    void run_raytracer(const SceneSnapshot &snapshot);
 
 protected:
 
@@ -45,8 +57,39 @@ private:
 
     void init();
 
+    /**
+     * A finished tile of one pass of a render, waiting to be drawn.
+     */
+    struct RenderedTile
+    {
+        Image *pixels;
+        int left;
+        int top;
+        int scale;
+    };
+
+    /**
+     * Start rendering the scene in the background.
+     */
     void render_scene();
 
+    /**
+     * Cancel the background render, if any, wait for the tiles it is
+     * tracing, and drop the tiles it left undrawn.
+     */
+    void wait_for_render();
+
+    /**
+     * Queue a tile to be drawn by the main thread. Called by the render
+     * thread, which gives up the pixels.
+     */
+    void post_tile(Image *pixels, int left, int top, int scale);
+
+    /**
+     * Draw the queued tiles. Runs on the main thread.
+     */
+    void on_tiles_rendered();
+
     Gtk::Box box;
 
     Gtk::Button btn_clear;
@@ -70,8 +113,23 @@ private:
 
     Canvas *canvas;
 
-    RadRt::Image *image;
     RadRt::Scene *scene;
+
+    RadRt::Raytracer raytracer;
+    std::thread render_thread;
+
+    // Guards the pass being traced, whether the render is cancelled, and
+    // the finished image, which the render thread hands over once the
+    // last pass and the tone reproduction are done
+    std::mutex render_mutex;
+    RadRt::RenderHandle *render_handle;
+    bool render_cancelled;
+    RadRt::Image *image;
+
+    // Wakes the main thread to draw the tiles the render thread queued
+    Glib::Dispatcher tiles_dispatcher;
+    std::mutex tiles_mutex;
+    std::vector<RenderedTile> rendered_tiles;
 };
 
 }   // namespace RadRt
@@ -14,22 +14,123 @@
 #include "shape.h"
 #include "vector3d.h"
 #include "image.h"
+#include "scene.h"
+#include "scenesnapshot.h"
+#include "traversalorder.h"
+
+#include <functional>
+#include <mutex>
+#include <vector>
 
 namespace RadRt
 {
 
 class Ray;
+class RayPacket;
 class Intersection;
+class RenderHandle;
+class ThreadPool;
 
+///
+/// @name Raytracer
+///
+/// @description
+/// 	Traces images of scenes. Tracing only reads the raytracer and an
+/// 	immutable snapshot of the scene, so any number of threads can trace
+/// 	at once, with one raytracer or several, of one scene or several.
+/// 	Only the settings must not change while a render runs.
+///
 class Raytracer
 {
 public:
 
+    ///
+    /// @name TileCallback
+    ///
+    /// @description
+    /// 	Called as each tile of an image is finished, with the image and
+    /// 	the columns and rows of the tile, each range excluding its end.
+    /// 	It runs on the thread that traced the tile, while other tiles are
+    /// 	still being traced, so only the pixels of the tile may be read.
+    ///
+    typedef std::function<void(const Image &image, int left, int top,
+                               int right, int bottom)> TileCallback;
+
     Raytracer();
-    ~Raytracer() {};
+    ~Raytracer();
 
     void set_max_depth(int max_depth) { m_max_depth = max_depth; };
 
+    ///
+    /// @name set_packet_size
+    ///
+    /// @description
+    /// 	Sets the side, in pixels, of the squares of primary rays traced
+    /// 	together through the acceleration structure. Packets do not change
+    /// 	the image, only how fast it is traced.
+    ///
+    /// @param packet_size - side of a packet, from 1 (every ray alone) to 8
+    ///
+    void set_packet_size(int packet_size);
+
+    ///
+    /// @name set_wavefront
+    ///
+    /// @description
+    /// 	Selects wavefront tracing, in which the rays of each bounce depth
+    /// 	are traced together, sorted by direction and origin, instead of
+    /// 	depth-first one at a time. The image is the same either way.
+    ///
+    /// @param wavefront - true to trace in wavefronts
+    ///
+    void set_wavefront(bool wavefront) { m_wavefront = wavefront; };
+
+    ///
+    /// @name set_tile_size
+    ///
+    /// @description
+    /// 	Sets the side, in pixels, of the square tiles the image is split
+    /// 	into. Tiles are traced independently of each other, in parallel
+    /// 	when there is more than one thread, and do not change the image.
+    ///
+    /// @param tile_size - side of a tile, at least 1
+    ///
+    void set_tile_size(int tile_size);
+
+    ///
+    /// @name set_thread_count
+    ///
+    /// @description
+    /// 	Sets the number of threads tracing tiles. The threads are kept
+    /// 	for every later call to trace_scene. The image is the same
+    /// 	whatever the number of threads.
+    ///
+    /// 	While renders are running the current threads are kept for them,
+    /// 	and for renders started before the last of them finishes; the
+    /// 	new number takes effect after that.
+    ///
+    /// @param thread_count - number of threads, or zero for one per
+    /// 	hardware thread
+    ///
+    void set_thread_count(unsigned int thread_count);
+
+    ///
+    /// @name set_traversal_order
+    ///
+    /// @description
+    /// 	Sets the order in which tiles are started, packets are traced
+    /// 	within a tile and rays are generated within a packet. Along a
+    /// 	space-filling curve, rays traced one after another pass through
+    /// 	the same parts of the acceleration structure. The image is the
+    /// 	same in any order.
+    ///
+    /// @param order - the order to visit tiles, packets and rays in
+    ///
+    void set_traversal_order(TraversalOrder order)
+    {
+        m_traversal_order = order;
+    };
+
     ///
     /// @name Trace
     ///
@@ -41,16 +142,264 @@ public:
     /// @param depth - recursion depth
     /// @return - color of the point the ray hits
     ///
-    Color trace(Scene *scene, Ray ray, int depth);
+    Color trace(const SceneSnapshot &scene, const Ray &ray, int depth) const;
+
+    ///
+    /// @name trace_scene
+    ///
+    /// @description
+    /// 	Traces an image of a scene, as it is when the call starts.
+    ///
+    /// @param scene - the scene to trace
+    /// @return - the image, owned by the caller
+    ///
+    Image *trace_scene(const Scene *scene) const;
+
+    ///
+    /// @name trace_scene
+    ///
+    /// @description
+    /// 	Traces an image of a snapshot of a scene.
+    ///
+    /// @param scene - the snapshot to trace
+    /// @return - the image, owned by the caller
+    ///
+    Image *trace_scene(const SceneSnapshot &scene) const;
+
+    ///
+    /// @name trace_scene
+    ///
+    /// @description
+    /// 	Traces an image of a snapshot of a scene, reporting each tile as
+    /// 	soon as it is finished.
+    ///
+    /// @param scene - the snapshot to trace
+    /// @param tile_traced - called for each finished tile
+    /// @return - the image, owned by the caller
+    ///
+    Image *trace_scene(const SceneSnapshot &scene,
+                       const TileCallback &tile_traced) const;
 
-    Image *trace_scene(Scene *scene);
+    ///
+    /// @name trace_scene_async
+    ///
+    /// @description
+    /// 	Starts tracing an image of a snapshot of a scene on the threads
+    /// 	of the raytracer, and returns without waiting for it. The handle
+    /// 	reports progress, cancels the render, and owns the image until
+    /// 	the caller takes it.
+    ///
+    /// @param scene - the snapshot to trace
+    /// @param tile_traced - called for each finished tile, if set
+    /// @return - the handle, owned by the caller
+    ///
+    RenderHandle *trace_scene_async(const SceneSnapshot &scene,
+                                    const TileCallback &tile_traced =
+                                        TileCallback()) const;
 
 private:
 
+    friend class RenderHandle;
+
+    Raytracer(const Raytracer &);
+    Raytracer &operator=(const Raytracer &);
+
+    ///
+    /// @name View
+    ///
+    /// @description
+    /// 	What every tile needs to generate its primary rays: the camera,
+    /// 	the position of each column and row of pixels on the projection
+    /// 	plane, and the order to trace them in.
+    ///
+    struct View
+    {
+        Point3d eye;
+        float focal_length;
+        std::vector<float> pixel_x;
+        std::vector<float> pixel_y;
+
+        int tiles_across;
+
+        // Tiles of the image, packets of a whole tile and rays of a whole
+        // packet, in traversal order. Tiles and packets at the edges skip
+        // the cells they do not have.
+        std::vector<int> tile_order;
+        std::vector<int> packet_order;
+        std::vector<int> ray_order;
+    };
+
+    ///
+    /// @name make_view
+    ///
+    /// @description
+    /// 	Computes the ray generation data for an image of a snapshot.
+    ///
+    View make_view(const SceneSnapshot &scene) const;
+
+    ///
+    /// @name effective_thread_count
+    ///
+    /// @description
+    /// 	Gets the number of threads to trace with, resolving zero to the
+    /// 	number of hardware threads.
+    ///
+    unsigned int effective_thread_count() const;
+
+    ///
+    /// @name acquire_thread_pool
+    ///
+    /// @description
+    /// 	Gets the threads tracing tiles, starting them on first use. The
+    /// 	pool stays alive until the caller calls release_thread_pool.
+    ///
+    /// @param thread_count - number of threads to start, if not started yet
+    ///
+    ThreadPool *acquire_thread_pool(unsigned int thread_count) const;
+
+    ///
+    /// @name release_thread_pool
+    ///
+    /// @description
+    /// 	Lets go of the pool got from acquire_thread_pool, stopping its
+    /// 	threads if the thread count changed while it was in use.
+    ///
+    void release_thread_pool() const;
+
+    ///
+    /// @name Wavefront
+    ///
+    /// @description
+    /// 	The rays of one bounce depth in wavefront tracing. Each ray adds
+    /// 	its color, times its weight, to that of the ray that spawned it.
+    ///
+    struct Wavefront
+    {
+        std::vector<Ray> rays;
+
+        // Ray of the previous depth that spawned each ray, or for primary
+        // rays the pixel
+        std::vector<int> parents;
+
+        std::vector<float> weights;
+        std::vector<Color> colors;
+
+        void add(const Ray &ray, int parent, float weight)
+        {
+            rays.push_back(ray);
+            parents.push_back(parent);
+            weights.push_back(weight);
+            colors.push_back(Color());
+        };
+    };
+
+    ///
+    /// @name trace
+    ///
+    /// @description
+    /// 	Traces a packet of primary rays, as if by tracing each of them
+    /// 	from the initial depth.
+    ///
+    /// @param packet - the rays to trace
+    /// @param colors - set to the color each ray sees
+    ///
+    void trace(const SceneSnapshot &scene, const RayPacket &packet,
+               Color colors[]) const;
+
+    ///
+    /// @name trace_tile
+    ///
+    /// @description
+    /// 	Traces the pixels of one tile of the image. Tiles share nothing
+    /// 	but the scene and the image, in which each sets only its own
+    /// 	pixels, so any number can be traced at once.
+    ///
+    /// @param view - ray generation data for the image
+    /// @param tile - index of the tile, counting along each row of tiles
+    /// 	from the first
+    /// @param image - the image to set the pixels of
+    /// @param tile_traced - called once the tile is finished, if set
+    ///
+    void trace_tile(const SceneSnapshot &scene, const View &view, int tile,
+                    Image *image, const TileCallback &tile_traced) const;
+
+    ///
+    /// @name trace
+    ///
+    /// @description
+    /// 	Traces a packet of primary rays as the first wavefront, queueing
+    /// 	the rays they spawn on the next.
+    ///
+    /// @param packet - the rays to trace
+    /// @param pixels - the pixel of each ray
+    /// @param wavefronts - one wavefront per depth, up to the maximum
+    ///
+    void trace(const SceneSnapshot &scene, const RayPacket &packet,
+               const int pixels[], std::vector<Wavefront> &wavefronts) const;
+
+    ///
+    /// @name trace_wavefronts
+    ///
+    /// @description
+    /// 	Traces the wavefronts after the first, depth by depth, then
+    /// 	combines the colors of every depth into those of the first.
+    ///
+    /// @param wavefronts - one wavefront per depth, up to the maximum
+    ///
+    void trace_wavefronts(const SceneSnapshot &scene,
+                          std::vector<Wavefront> &wavefronts) const;
+
+    ///
+    /// @name shade
+    ///
+    /// @description
+    /// 	Computes the color seen along a ray at its closest intersection,
+    /// 	tracing the reflected and transmitted rays.
+    ///
+    /// @param ray - the ray that hit
+    /// @param intersection - where it hit
+    /// @param depth - recursion depth of the ray
+    /// @return - color seen along the ray
+    ///
+    Color shade(const SceneSnapshot &scene, const Ray &ray,
+                Intersection &intersection, int depth) const;
+
+    ///
+    /// @name shade
+    ///
+    /// @description
+    /// 	Computes the local color at the closest intersection of a ray in
+    /// 	a wavefront, queueing the reflected and transmitted rays on the
+    /// 	next wavefront.
+    ///
+    /// @param index - the ray within its wavefront
+    /// @param next - the wavefront of the next depth
+    /// @return - local color at the intersection
+    ///
+    Color shade(const SceneSnapshot &scene, const Ray &ray,
+                Intersection &intersection, int index,
+                Wavefront &next) const;
+
+    ///
+    /// @name secondary_rays
+    ///
+    /// @description
+    /// 	Computes the reflected and transmitted rays leaving an
+    /// 	intersection, with the weights of the colors they see. Must be
+    /// 	called after local shading, as it may flip the normal.
+    ///
+    /// @param rays - set to the rays, room for two
+    /// @param weights - set to the weight of each ray
+    /// @return - the number of rays
+    ///
+    int secondary_rays(const Ray &ray, Intersection &intersection,
+                       Ray rays[], float weights[]) const;
+
     Ray make_reflection_ray(const Vector3d &normal, const Ray &ray,
-                            const Point3d &intersection);
+                            const Point3d &intersection) const;
 
-    Intersection *get_closest_intersection(Scene *scene, const Ray &ray);
+    bool get_closest_intersection(const SceneSnapshot &scene, const Ray &ray,
+                                  Intersection &intersection) const;
 
     ///
     /// @name mMaxDepth
@@ -60,6 +409,67 @@ private:
     ///
     int m_max_depth;
 
+    ///
+    /// @name m_packet_size
+    ///
+    /// @description
+    ///		Side of the squares of primary rays traced together.
+    ///
+    int m_packet_size;
+
+    ///
+    /// @name m_wavefront
+    ///
+    /// @description
+    ///		Whether rays are traced in wavefronts.
+    ///
+    bool m_wavefront;
+
+    ///
+    /// @name m_tile_size
+    ///
+    /// @description
+    ///		Side of the tiles the image is split into.
+    ///
+    int m_tile_size;
+
+    ///
+    /// @name m_thread_count
+    ///
+    /// @description
+    ///		Number of threads tracing tiles, zero for one per hardware thread.
+    ///
+    unsigned int m_thread_count;
+
+    ///
+    /// @name m_traversal_order
+    ///
+    /// @description
+    ///		Order of the tiles, the packets in a tile and the rays in a packet.
+    ///
+    TraversalOrder m_traversal_order;
+
+    ///
+    /// @name m_pool
+    ///
+    /// @description
+    ///		Threads tracing tiles, started by the first render that uses more
+    ///		than one, and shared by every render after it.
+    ///
+    mutable ThreadPool *m_pool;
+    mutable std::mutex m_pool_mutex;
+
+    ///
+    /// @name m_pool_users
+    ///
+    /// @description
+    ///		Number of renders using m_pool, and whether it is to be stopped
+    ///		once they are done because the thread count changed. Guarded by
+    ///		m_pool_mutex, like m_pool and m_thread_count.
+    ///
+    mutable unsigned int m_pool_users;
+    mutable bool m_pool_stale;
+
     ///
     /// @name mPhongShader
     ///
@@ -68,8 +478,6 @@ private:
     ///
     PhongShader m_phong_shader;
 
-    Point3d *m_intersection;
-
 };  // class Raytracer
 
 }   // namespace RadRt
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef RENDERHANDLE_H_INCLUDED
+#define RENDERHANDLE_H_INCLUDED
+
+#include "image.h"
+#include "raytracer.h"
+#include "scenesnapshot.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <future>
+
+namespace RadRt
+{
+
+/**
+ * A render started by Raytracer::trace_scene_async, running on the threads
+ * of the raytracer while the caller goes on. The handle reports how many
+ * tiles are done, can cancel the tiles not started yet, and owns the image
+ * until the caller takes it.
+ *
+ * Cancelling is checked as each tile starts, so the threads are free again
+ * once the tiles they are tracing finish. The image of a cancelled render
+ * is dropped.
+ *
+ * The raytracer must outlive the handle.
+ */
+class RenderHandle
+{
+public:
+
+    /**
+     * Cancel the render if it is still running, wait for the tiles being
+     * traced to finish, and free the image unless it was taken.
+     */
+    ~RenderHandle();
+
+    int tile_count() const { return m_tile_count; };
+
+    /**
+     * Get the number of tiles traced so far.
+     */
+    int tiles_traced() const { return m_tiles_traced; };
+
+    /**
+     * Get the fraction of the tiles traced so far, from 0 to 1.
+     */
+    float progress() const;
+
+    /**
+     * Stop tracing the tiles not started yet. Callable from any thread, at
+     * any time.
+     */
+    void cancel() { m_cancelled = true; };
+
+    bool cancelled() const { return m_cancelled; };
+
+    /**
+     * Get the future that is ready once every tile has been traced or
+     * skipped.
+     */
+    const std::shared_future<void> &finished() const { return m_finished; };
+
+    /**
+     * Wait for the render to finish and get the image, still owned by the
+     * handle, or nullptr if the render was cancelled or the image taken.
+     */
+    Image *image() const;
+
+    /**
+     * Wait for the render to finish and take the image, which the caller
+     * then owns. Returns nullptr if the render was cancelled or the image
+     * already taken.
+     */
+    Image *take_image();
+
+private:
+
+    friend class Raytracer;
+
+    RenderHandle(const Raytracer *raytracer, ThreadPool *pool,
+                 const SceneSnapshot &scene,
+                 const Raytracer::TileCallback &tile_traced);
+
+    RenderHandle(const RenderHandle &);
+    RenderHandle &operator=(const RenderHandle &);
+
+    /**
+     * Trace one tile unless cancelled, and mark the render finished once
+     * every tile is done. Runs on a worker of the pool.
+     */
+    void run_tile(int tile);
+
+    const Raytracer *m_raytracer;
+    ThreadPool *m_pool;
+
+    // Copies, so that the caller need not keep them
+    SceneSnapshot m_scene;
+    Raytracer::TileCallback m_tile_traced;
+
+    Raytracer::View m_view;
+    Image *m_pixels;
+
+    int m_tile_count;
+    std::atomic<int> m_tiles_traced;
+    std::atomic<int> m_tiles_left;
+    std::atomic<bool> m_cancelled;
+
+    std::promise<void> m_promise;
+    std::shared_future<void> m_finished;
+
+    // Tiles queued on the pool, waited for by the destructor
+    ThreadPool::TaskGroup m_tiles;
+};
+
+}   // namespace RadRt
+
+#endif // RENDERHANDLE_H_INCLUDED
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef TRAVERSALORDER_H_INCLUDED
+#define TRAVERSALORDER_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+namespace RadRt
+{
+
+/**
+ * Orders in which the cells of a grid, such as the tiles of an image or
+ * the pixels of a tile, are visited. Along a space-filling curve, cells
+ * visited one after another are close together on every scale, so rays
+ * traced in that order keep finding the parts of the scene they need in
+ * cache.
+ */
+enum TraversalOrder
+{
+    // Row by row
+    SCANLINE_ORDER,
+
+    // Z-shaped curve, quadrant by quadrant
+    MORTON_ORDER,
+
+    // U-shaped curve that only ever steps to a neighboring cell
+    HILBERT_ORDER
+};
+
+/**
+ * Find a traversal order by name: "scanline", "morton" or "hilbert".
+ *
+ * @return Whether the name is known.
+ */
+bool traversal_order_from_name(const std::string &name,
+                               TraversalOrder &order);
+
+/**
+ * List the cells of a grid in a traversal order. Curves cover the smallest
+ * square of a power of two side around the grid, skipping the cells
+ * outside it.
+ *
+ * @param order Order to visit the cells in.
+ * @param columns Width of the grid.
+ * @param rows Height of the grid.
+ * @param cells Set to each cell, as its row times the columns plus its
+ *        column.
+ */
+void traverse_grid(TraversalOrder order, int columns, int rows,
+                   std::vector<int> &cells);
+
+}   // namespace RadRt
+
+#endif // TRAVERSALORDER_H_INCLUDED
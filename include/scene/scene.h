@@ -10,6 +10,9 @@
 #include "ijsonserializable.h"
 #include "light.h"
 #include "shape.h"
+#include "shapegroup.h"
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace RadRt
@@ -21,6 +24,9 @@ typedef std::vector<Shape*>::const_iterator ShapeConstIterator;
 typedef std::vector<Light*> LightVector;
 typedef std::vector<Light*>::iterator LightIterator;
 typedef std::vector<Light*>::const_iterator LightConstIterator;
+typedef std::vector<ShapeGroup*> ShapeGroupVector;
+
+class Accelerator;
 
 class Scene : public IJsonSerializable
 {
@@ -33,22 +39,84 @@ public:
     // Accessors
     int width() const { return m_width; };
     int height() const { return m_height; };
-    Camera camera() const { return m_camera; };
+    const Camera &camera() const { return m_camera; };
     Color background() const { return m_background; };
     ShapeVector *shapes() const { return s_shapes; };
     LightVector *lights() const { return m_lights; };
+    const Accelerator *accelerator() const { return m_accelerator; };
+    const ShapeGroupVector &groups() const { return m_groups; };
+
+    /**
+     * Find a shape group by name.
+     *
+     * @return The group, or nullptr if the scene has no group of that name.
+     */
+    const ShapeGroup *group(const std::string &name) const;
 
     // Mutators
     void set_width( int width ) { this->m_width = width; };
     void set_height( int height ) { this->m_height = height; };
     void set_camera(const Camera &camera) { this->m_camera = camera; };
     void set_background(const Color &color) { this->m_background = color; };
-    void add_shape(Shape *shape) { s_shapes->push_back(shape); };
+    void add_shape(Shape *shape)
+    {
+        s_shapes->push_back(shape);
+        m_shapes_hashed = false;
+    };
     void add_light(Light *light) { m_lights->push_back(light); };
+    void add_group(ShapeGroup *group) { m_groups.push_back(group); };
 
     Json::Value serialize() const;
     void deserialize(const Json::Value &root);
 
+    /**
+     * Choose the kind of acceleration structure used for ray queries: one
+     * of "bvh" (the default), "qbvh", "grid" or "list". Takes effect on the
+     * next call to build_accelerator().
+     */
+    void set_accelerator_type(const std::string &type)
+    {
+        this->m_accelerator_type = type;
+    };
+
+    /**
+     * Rebuild the acceleration structure over the current set of shapes.
+     * This is done automatically by deserialize(), but must be called again
+     * after shapes are added with add_shape().
+     */
+    void build_accelerator();
+
+    /**
+     * Bring the acceleration structure up to date after shapes have moved,
+     * as when animating a scene. This is much cheaper than
+     * build_accelerator(), but only valid if no shapes were added since the
+     * structure was last built.
+     */
+    void update_accelerator();
+
+    /**
+     * Keep the acceleration structure in a file, typically next to the
+     * scene file. The structure is loaded from the file instead of being
+     * built when the shapes and accelerator type are unchanged since it was
+     * saved, so edits to the camera, lights or image size keep the cache
+     * valid. Only takes effect for scenes read with deserialize(), and must
+     * be set before it is called.
+     *
+     * @param filename File to keep the structure in, or an empty string to
+     *        disable caching.
+     */
+    void set_accelerator_cache(const std::string &filename)
+    {
+        this->m_accelerator_cache = filename;
+    };
+
+    /**
+     * Name the file the scene is read from, so that the files it names in
+     * turn, such as those of meshes, are found next to it rather than in
+     * the working directory. Must be set before deserialize() is called.
+     */
+    void set_scene_file(const std::string &filename);
+
 private:
 
     int m_width;
@@ -60,6 +128,22 @@ private:
 
     ShapeVector *s_shapes;
     LightVector *m_lights;
+
+    // Groups placed by instances among the shapes
+    ShapeGroupVector m_groups;
+
+    std::string m_accelerator_type;
+    Accelerator *m_accelerator;
+
+    std::string m_accelerator_cache;
+
+    // Directory of the scene file, or empty for the working directory.
+    std::string m_directory;
+
+    // Hash of the shapes as read by deserialize(), valid until shapes are
+    // added.
+    uint64_t m_shapes_hash;
+    bool m_shapes_hashed;
 };
 
 }   // namespace RadRt
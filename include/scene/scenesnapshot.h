@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef SCENESNAPSHOT_H_INCLUDED
+#define SCENESNAPSHOT_H_INCLUDED
+
+#include "camera.h"
+#include "color.h"
+#include "light.h"
+
+#include <vector>
+
+namespace RadRt
+{
+
+class Accelerator;
+class Scene;
+
+/**
+ * What a render reads from a scene, fixed when the render starts. The
+ * camera, background and lights are copied, so the scene can be edited
+ * while renders of an earlier state run. The acceleration structure and
+ * the shapes behind it are shared, and only read through const methods.
+ * A snapshot never changes, so any number of threads can trace it at once.
+ *
+ * The shapes and acceleration structure of the scene must outlive the
+ * snapshot, and must not change until every render using it has finished.
+ */
+class SceneSnapshot
+{
+public:
+
+    explicit SceneSnapshot(const Scene &scene);
+
+    /**
+     * Snapshot of the same scene traced at another resolution, with the
+     * same field of view.
+     */
+    SceneSnapshot(const SceneSnapshot &scene, int width, int height);
+
+    int width() const { return m_width; };
+    int height() const { return m_height; };
+    const Camera &camera() const { return m_camera; };
+    const Color &background() const { return m_background; };
+    const std::vector<Light> &lights() const { return m_lights; };
+    const Accelerator *accelerator() const { return m_accelerator; };
+
+private:
+
+    int m_width;
+    int m_height;
+
+    Camera m_camera;
+
+    Color m_background;
+
+    std::vector<Light> m_lights;
+
+    const Accelerator *m_accelerator;
+};
+
+}   // namespace RadRt
+
+#endif // SCENESNAPSHOT_H_INCLUDED
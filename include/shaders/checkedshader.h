@@ -20,7 +20,7 @@ public:
 
     CheckedShader() {};
 
-    Color shade( const Point3d &p );
+    Color shade( const Point3d &p ) const;
 
     Json::Value serialize() const;
     void deserialize(const Json::Value &root);
@@ -8,7 +8,7 @@
 
 #include "shape.h"
 #include "point3d.h"
-#include "scene.h"
+#include "scenesnapshot.h"
 
 namespace RadRt
 {
@@ -19,7 +19,8 @@ class PhongShader
 {
 public:
 
-    Color shade(Scene *scene, Intersection *intersection);
+    Color shade(const SceneSnapshot &scene,
+                const Intersection &intersection) const;
 
 };  // class PhongShader
 
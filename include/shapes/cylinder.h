@@ -28,7 +28,30 @@ public:
     Json::Value serialize() const;
     void deserialize(const Json::Value &root);
 
-    Ray *intersect(const Ray &ray);
+    bool intersect(const Ray &ray, Intersection &hit) const;
+
+    ///
+    /// @name intersection_at
+    ///
+    /// @description
+    /// 	Fill in the intersection of a ray known to hit this cylinder at a
+    /// 	given distance along it.
+    ///
+    void intersection_at(const Ray &ray, float t, Intersection &hit) const;
+
+    void translate(const Vector3d &offset);
+
+    ///
+    /// @name base
+    ///
+    /// @description
+    /// 	Accessors for the frame set up by init(): the cylinder extends
+    /// 	from base() for height() along the unit vector axis().
+    ///
+    const Point3d &base() const { return m_center_point_2; };
+    const Vector3d &axis() const { return m_orientation; };
+    float height() const { return m_height; };
+    float radius() const { return m_radius; };
 
 private:
 
@@ -37,8 +60,12 @@ private:
 
     float m_radius;
 
+    // Unit vector from the second center point towards the first
     Vector3d m_orientation;
 
+    float m_height;
+    float m_radius_squared;
+
 };  // class Cylinder
 
 }   // namespace RadRt
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef INSTANCE_H_INCLUDED
+#define INSTANCE_H_INCLUDED
+
+#include "shape.h"
+#include "shapegroup.h"
+#include "transform.h"
+
+namespace RadRt
+{
+
+/**
+ * A placement of a shape group in the scene. The group is scaled, then
+ * rotated about an axis through its origin, then translated. Rays are
+ * carried into the group's coordinate system and traced against its shared
+ * acceleration structure, so an instance costs a transform no matter how
+ * many shapes the group holds.
+ *
+ * Hits report the shape within the group as the surface hit, so the
+ * material of an instance is that of its group's shapes.
+ */
+class Instance : public Shape
+{
+public:
+
+    /**
+     * @param group Group to place. It is not owned by the instance and
+     *        must outlive it.
+     */
+    Instance(const ShapeGroup *group);
+    ~Instance() {};
+
+    void init();
+
+    Json::Value serialize() const;
+    void deserialize(const Json::Value &root);
+
+    bool intersect(const Ray &ray, Intersection &hit) const;
+    bool occludes(const Ray &ray, const Intersection *origin,
+                  float &transmission) const;
+
+    void translate(const Vector3d &offset);
+
+    const ShapeGroup *group() const { return m_group; };
+
+private:
+
+    /**
+     * Carry a ray into the group's coordinate system. The direction is not
+     * renormalized, so distances along the ray and its interval are
+     * unchanged.
+     */
+    Ray to_object(const Ray &ray) const;
+
+    const ShapeGroup *m_group;
+
+    Vector3d m_scale;
+    Vector3d m_rotation_axis;
+    float m_rotation_angle;
+    Vector3d m_translation;
+
+    Transform m_to_world;
+    Transform m_to_object;
+
+};  // class Instance
+
+}   // namespace RadRt
+
+#endif // INSTANCE_H_INCLUDED
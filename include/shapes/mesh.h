@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef MESH_H_INCLUDED
+#define MESH_H_INCLUDED
+
+#include "shape.h"
+
+#include <string>
+#include <vector>
+
+namespace RadRt
+{
+
+/**
+ * A triangle mesh read from an OBJ or binary PLY file, with the triangles
+ * sharing their vertices through an index buffer. Each triangle is a
+ * primitive of its own, so that acceleration structures sort the triangles
+ * of a mesh among each other and among the other shapes of the scene.
+ *
+ * The whole mesh has one material. Normals are those of the triangles,
+ * facing the side from which their corners run counterclockwise.
+ */
+class Mesh : public Shape
+{
+public:
+
+    Mesh() {};
+    ~Mesh() {};
+
+    void init();
+
+    /**
+     * Set the directory that a relative file name is read from, normally
+     * that of the scene file. Must be set before deserialize(); without
+     * it, files are read from the working directory.
+     */
+    void set_directory(const std::string &directory)
+    {
+        m_directory = directory;
+    };
+
+    /**
+     * Write the mesh with its file name as the scene gave it, not as it was
+     * resolved.
+     */
+    Json::Value serialize() const;
+    void deserialize(const Json::Value &root);
+
+    bool intersect(const Ray &ray, Intersection &hit) const;
+
+    /**
+     * Determine whether the mesh blocks a ray. Unlike other shapes, a mesh
+     * can block rays leaving its own surface, so that it shadows itself;
+     * the start of the ray interval keeps the triangle the ray leaves from
+     * from blocking it.
+     */
+    bool occludes(const Ray &ray, const Intersection *origin,
+                  float &transmission) const;
+
+    /**
+     * Fill in the intersection of a ray known to hit a triangle at a given
+     * distance along it.
+     */
+    void intersection_at(const Ray &ray, float t, unsigned int triangle,
+                         Intersection &hit) const;
+
+    void translate(const Vector3d &offset);
+
+    unsigned int primitive_count() const { return m_indices.size() / 3; };
+    BoundingBox primitive_bounds(unsigned int index) const;
+
+    /**
+     * Get the first corner of a triangle, and its edges from there to the
+     * other two, as Mesh::intersect uses them.
+     */
+    void triangle(unsigned int index, Point3d &corner, Vector3d &edge1,
+                  Vector3d &edge2) const;
+
+    /**
+     * Get the modification time and size of the file the mesh was read
+     * from, to tell when it has changed.
+     */
+    const std::string &file_stamp() const { return m_file_stamp; };
+
+private:
+
+    /**
+     * Intersect a ray with one triangle, by the Moller-Trumbore algorithm.
+     * TriangleBatch repeats these steps exactly.
+     */
+    bool intersect_triangle(unsigned int index, const Ray &ray,
+                            float &t) const;
+
+    Point3d vertex(unsigned int index) const
+    {
+        return Point3d(m_vertices[3 * index], m_vertices[3 * index + 1],
+                       m_vertices[3 * index + 2]);
+    };
+
+    std::string m_directory;
+    std::string m_filename;
+    std::string m_file_stamp;
+
+    // Displacement of the vertices from where the file puts them
+    Vector3d m_offset;
+
+    std::vector<float> m_vertices;
+    std::vector<unsigned int> m_indices;
+
+};  // class Mesh
+
+}   // namespace RadRt
+
+#endif // MESH_H_INCLUDED
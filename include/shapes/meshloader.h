@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef MESHLOADER_H_INCLUDED
+#define MESHLOADER_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace RadRt
+{
+
+/**
+ * Reads triangle meshes from Wavefront OBJ files and binary PLY files.
+ * The file is mapped into memory and parsed in place, so that large meshes
+ * are read without copying them through stream buffers first. Polygons
+ * with more than three corners are split into fans of triangles.
+ *
+ * Only positions are read; texture coordinates, normals and any other
+ * properties are skipped.
+ */
+class MeshLoader
+{
+public:
+
+    /**
+     * Read a mesh. The format is recognized by the contents of the file,
+     * not by its name.
+     *
+     * @param filename File to read.
+     * @param vertices Set to the x, y and z coordinates of each vertex.
+     * @param indices Set to the three vertices of each triangle, as
+     *        indices into the vertex array.
+     * @return True if the mesh was read. Otherwise an error is reported on
+     *         std::cerr and the arrays are left empty.
+     */
+    bool load(const std::string &filename, std::vector<float> &vertices,
+              std::vector<unsigned int> &indices);
+
+private:
+
+    bool load_obj(const char *data, size_t size,
+                  std::vector<float> &vertices,
+                  std::vector<unsigned int> &indices);
+
+    bool load_ply(const char *data, size_t size,
+                  std::vector<float> &vertices,
+                  std::vector<unsigned int> &indices);
+
+    // File being read, for error messages
+    std::string m_filename;
+};
+
+}   // namespace RadRt
+
+#endif // MESHLOADER_H_INCLUDED
@@ -23,13 +23,38 @@ public:
     Json::Value serialize() const;
     void deserialize(const Json::Value &root);
 
-    Ray *intersect(const Ray &ray);
+    bool intersect(const Ray &ray, Intersection &hit) const;
+
+    ///
+    /// @name intersection_at
+    ///
+    /// @description
+    /// 	Fill in the intersection of a ray known to hit this rectangle at
+    /// 	a given distance along it.
+    ///
+    void intersection_at(const Ray &ray, float t, Intersection &hit) const;
+
+    void translate(const Vector3d &offset);
 
     const Point3d &a() const { return m_a; };
     const Point3d &b() const { return m_b; };
     const Point3d &c() const { return m_c; };
     const Point3d &d() const { return m_d; };
 
+    ///
+    /// @name normal
+    ///
+    /// @description
+    /// 	Accessors for the plane and edge data set up by init(). The
+    /// 	plane holds the points p with normal * p = plane_offset. A point
+    /// 	of it is inside when its displacement from corner c has a dot
+    /// 	product in [0, 1) with both edge_u and edge_v.
+    ///
+    const Vector3d &normal() const { return m_normal; };
+    float plane_offset() const { return m_plane_offset; };
+    const Vector3d &edge_u() const { return m_edge_u; };
+    const Vector3d &edge_v() const { return m_edge_v; };
+
 private:
 
     Point3d m_a;
@@ -38,6 +63,11 @@ private:
     Point3d m_d;
 
     Vector3d m_normal;
+    float m_plane_offset;
+
+    // Edges from corner c, divided by their squared lengths
+    Vector3d m_edge_u;
+    Vector3d m_edge_v;
 
 };  // class Rectangle
 
@@ -6,6 +6,7 @@
 #ifndef SHAPE_H
 #define SHAPE_H
 
+#include "boundingbox.h"
 #include "point3d.h"
 #include "color.h"
 #include "vector3d.h"
@@ -15,12 +16,21 @@
 namespace RadRt
 {
 
+class Intersection;
 class Ray;
 
 class Shape : public IJsonSerializable
 {
 public:
 
+    ///
+    /// @name Shape
+    ///
+    /// @description
+    /// 	Constructor
+    ///
+    Shape();
+
     ///
     /// @name ~Shape
     ///
@@ -41,7 +51,7 @@ public:
     /// @param - point on surface for color calculation
     /// @return - the ambient light component of this object
     ///
-    virtual Color ambient_color(Point3d p);
+    virtual Color ambient_color(Point3d p) const;
 
     ///
     /// @name GetDiffuseColor
@@ -52,7 +62,7 @@ public:
     /// @param - point on surface for color calculation
     /// @return - the diffuse light component of this object
     ///
-    virtual Color diffuse_color(Point3d p);
+    virtual Color diffuse_color(Point3d p) const;
 
     ///
     /// @name GetSpecularColor
@@ -72,10 +82,119 @@ public:
     float transmissive_constant() const { return m_transmission_constant; };
     float refraction_index() const { return m_refraction_index; };
 
-    virtual Ray *intersect(const Ray &ray) = 0;
+    ///
+    /// @name intersect
+    ///
+    /// @description
+    /// 	Find the nearest point at which a ray hits this object. The
+    /// 	object reported as hit supplies the material there; it is this
+    /// 	object, except for compound objects made up of other objects.
+    ///
+    /// @param ray - the ray to intersect; hits outside its interval are
+    /// 	ignored
+    /// @param hit - set to the intersection, if there is one
+    /// @return - true if the ray hits this object
+    ///
+    virtual bool intersect(const Ray &ray, Intersection &hit) const = 0;
+
+    ///
+    /// @name occludes
+    ///
+    /// @description
+    /// 	Determine whether this object blocks a ray within its interval.
+    /// 	Transparent surfaces crossed on the way attenuate the ray instead
+    /// 	of blocking it.
+    ///
+    /// @param ray - the ray to test
+    /// @param origin - intersection the ray leaves from, whose surface is
+    /// 	skipped, or nullptr
+    /// @param transmission - multiplied by the transmissive constant of
+    /// 	each transparent surface crossed
+    /// @return - true if an opaque surface blocks the ray
+    ///
+    virtual bool occludes(const Ray &ray, const Intersection *origin,
+                          float &transmission) const;
+
+    ///
+    /// @name translate
+    ///
+    /// @description
+    /// 	Move this object, updating its bounds. Acceleration structures
+    /// 	containing the object must be updated afterwards.
+    ///
+    /// @param offset - the displacement to apply
+    ///
+    virtual void translate(const Vector3d &offset) = 0;
+
+    ///
+    /// @name bounds
+    ///
+    /// @description
+    /// 	Accessor for the world-space extent of this object, as computed
+    /// 	when the object was last initialized.
+    ///
+    /// @return - the smallest axis-aligned box containing this object
+    ///
+    const BoundingBox &bounds() const { return m_bounds; };
+
+    ///
+    /// @name bounding_center
+    ///
+    /// @description
+    /// 	Accessor for the center of a sphere enclosing this object.
+    ///
+    const Point3d &bounding_center() const { return m_bounding_center; };
+
+    ///
+    /// @name bounding_radius
+    ///
+    /// @description
+    /// 	Accessor for the radius of a sphere enclosing this object.
+    ///
+    float bounding_radius() const { return m_bounding_radius; };
+
+    ///
+    /// @name primitive_count
+    ///
+    /// @description
+    /// 	Number of primitives this object is made of: parts that
+    /// 	acceleration structures may place apart from each other, such as
+    /// 	the triangles of a mesh. Most objects are a single primitive.
+    ///
+    virtual unsigned int primitive_count() const { return 1; };
+
+    ///
+    /// @name primitive_bounds
+    ///
+    /// @description
+    /// 	Accessor for the world-space extent of one primitive.
+    ///
+    /// @param index - the primitive, less than primitive_count()
+    /// @return - the smallest axis-aligned box containing the primitive
+    ///
+    virtual BoundingBox primitive_bounds(unsigned int /* index */) const
+    {
+        return m_bounds;
+    };
 
     void set_shader( ProceduralShader *newShader );
 
+protected:
+
+    ///
+    /// @name set_bounds
+    ///
+    /// @description
+    /// 	Record the extent of this object. Subclasses call this from
+    /// 	init() whenever their geometry changes. The bounding sphere is
+    /// 	derived from the box unless given explicitly.
+    ///
+    /// @param bounds - the smallest axis-aligned box containing this object
+    ///
+    void set_bounds(const BoundingBox &bounds);
+    void set_bounds(const BoundingBox &bounds, const Point3d &center,
+                    float radius);
+
 private:
 
     Color m_ambient_color;
@@ -91,9 +210,13 @@ private:
 
     ProceduralShader *m_shader;
 
+    BoundingBox m_bounds;
+    Point3d m_bounding_center;
+    float m_bounding_radius;
+
 };  // class Shape
 
-inline Color Shape::ambient_color(Point3d p)
+inline Color Shape::ambient_color(Point3d p) const
 {
     if (m_shader == nullptr)
         return m_ambient_color;
@@ -101,7 +224,7 @@ inline Color Shape::ambient_color(Point3d p)
         return m_shader->shade(p);
 }
 
-inline Color Shape::diffuse_color(Point3d p)
+inline Color Shape::diffuse_color(Point3d p) const
 {
     if (m_shader == nullptr)
         return m_diffuse_color;
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef SHAPEGROUP_H_INCLUDED
+#define SHAPEGROUP_H_INCLUDED
+
+#include "boundingbox.h"
+#include "ijsonserializable.h"
+#include "shape.h"
+
+#include <string>
+#include <vector>
+
+namespace RadRt
+{
+
+class Accelerator;
+
+/**
+ * A named set of shapes that is placed in a scene any number of times
+ * through instances. The group owns its shapes and an acceleration
+ * structure over them in the group's own coordinate system, both shared by
+ * every instance.
+ */
+class ShapeGroup : public IJsonSerializable
+{
+public:
+
+    ShapeGroup();
+    ~ShapeGroup();
+
+    const std::string &name() const { return m_name; };
+    const std::vector<Shape*> &shapes() const { return m_shapes; };
+    const Accelerator *accelerator() const { return m_accelerator; };
+
+    BoundingBox bounds() const;
+
+    /**
+     * Set the directory that files named by the shapes of the group are
+     * read from, as Mesh::set_directory. Must be set before deserialize().
+     */
+    void set_directory(const std::string &directory)
+    {
+        m_directory = directory;
+    };
+
+    Json::Value serialize() const;
+    void deserialize(const Json::Value &root);
+
+private:
+
+    std::string m_name;
+    std::string m_directory;
+    std::vector<Shape*> m_shapes;
+    Accelerator *m_accelerator;
+
+    // Not copyable, as it owns its shapes
+    ShapeGroup(const ShapeGroup&);
+    ShapeGroup &operator=(const ShapeGroup&);
+
+};  // class ShapeGroup
+
+}   // namespace RadRt
+
+#endif // SHAPEGROUP_H_INCLUDED
@@ -17,10 +17,26 @@ public:
 
     ~Sphere() {};
 
+    void init();
+
     Json::Value serialize() const;
     void deserialize(const Json::Value &root);
 
-    Ray *intersect(const Ray &ray);
+    bool intersect(const Ray &ray, Intersection &hit) const;
+
+    ///
+    /// @name intersection_at
+    ///
+    /// @description
+    /// 	Fill in the intersection of a ray known to hit this sphere at a
+    /// 	given distance along it.
+    ///
+    void intersection_at(const Ray &ray, float t, Intersection &hit) const;
+
+    void translate(const Vector3d &offset);
+
+    const Point3d &center() const { return m_center; };
+    float radius() const { return m_radius; };
 
 private:
 
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#ifndef THREADPOOL_H_INCLUDED
+#define THREADPOOL_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace RadRt
+{
+
+/**
+ * A fixed set of worker threads sharing tasks by work stealing. Every
+ * worker has its own deque of tasks: it runs the newest task it queued
+ * itself first, and when it runs out it steals the oldest task of another
+ * worker. Tasks may queue further tasks and wait for them, so recursive
+ * work such as building the halves of a tree spreads over the workers.
+ */
+class ThreadPool
+{
+public:
+
+    /**
+     * A set of tasks that can be waited for together.
+     */
+    class TaskGroup
+    {
+    public:
+
+        TaskGroup(): m_pending(0) {};
+
+    private:
+
+        friend class ThreadPool;
+
+        TaskGroup(const TaskGroup &);
+        TaskGroup &operator=(const TaskGroup &);
+
+        std::atomic<unsigned int> m_pending;
+    };
+
+    /**
+     * Work done by one worker since the pool started.
+     */
+    struct WorkerStatistics
+    {
+        unsigned int tasks;
+        unsigned int steals;
+
+        // Time spent running tasks, not counting time spent blocked in
+        // them waiting for tasks running elsewhere
+        double busy_seconds;
+    };
+
+    /**
+     * Start the worker threads.
+     *
+     * @param thread_count Number of workers. Zero selects one worker per
+     *        hardware thread.
+     */
+    explicit ThreadPool(unsigned int thread_count = 0);
+
+    /**
+     * Finish the queued tasks and stop the workers.
+     */
+    ~ThreadPool();
+
+    unsigned int thread_count() const { return m_workers.size(); };
+
+    /**
+     * Queue a task to run on one of the workers.
+     *
+     * @param task Task to run.
+     */
+    void submit(const std::function<void()> &task);
+
+    /**
+     * Queue a task as part of a group. Tasks queued by a worker go on its
+     * own deque; tasks queued from other threads are dealt out over the
+     * workers in turn.
+     *
+     * @param group Group the task belongs to.
+     * @param task Task to run.
+     */
+    void submit(TaskGroup &group, const std::function<void()> &task);
+
+    /**
+     * Block until every task submitted so far without a group has
+     * finished. Must not be called from a task.
+     */
+    void wait();
+
+    /**
+     * Block until every task of a group has finished. A worker waiting in
+     * a task runs other queued tasks in the meantime, so tasks can wait
+     * for tasks they queue.
+     *
+     * @param group Group to wait for.
+     */
+    void wait(TaskGroup &group);
+
+    /**
+     * Run a function over a range of indices, split into chunks that are
+     * spread over the workers, and wait for all of them to finish. May be
+     * called from a task.
+     *
+     * @param begin First index.
+     * @param end One past the last index.
+     * @param grain Smallest number of indices handed to a single task.
+     * @param function Called with the bounds of each chunk.
+     */
+    void parallel_for(unsigned int begin, unsigned int end,
+                      unsigned int grain,
+                      const std::function<void(unsigned int,
+                                               unsigned int)> &function);
+
+    /**
+     * Get the work done by each worker so far. Tasks still running are
+     * not counted yet.
+     */
+    std::vector<WorkerStatistics> statistics() const;
+
+    /**
+     * Get the number of hardware threads, or one if it is unknown.
+     */
+    static unsigned int hardware_threads();
+
+private:
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Task
+    {
+        std::function<void()> function;
+        TaskGroup *group;
+    };
+
+    struct Worker
+    {
+        // Guards the tasks and the statistics
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        WorkerStatistics statistics;
+
+        // Nesting of tasks run by this worker, counting waits in them
+        int depth;
+        Clock::time_point started;
+    };
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+    void run(unsigned int index);
+
+    /**
+     * Take a queued task: the newest of the worker's own, else the oldest
+     * of another worker's. Pass the number of workers for a thread that
+     * is not a worker, which can only steal.
+     */
+    bool take(unsigned int index, Task &task);
+
+    void execute(unsigned int index, Task &task);
+
+    /**
+     * Get the index of the calling thread among the workers, or the number
+     * of workers if it is not one of them.
+     */
+    unsigned int current_worker() const;
+
+    std::vector<std::thread> m_threads;
+    std::vector<Worker*> m_workers;
+
+    // Tasks queued on any deque and not yet taken
+    std::atomic<unsigned int> m_queued;
+
+    // Worker that receives the next task queued from outside the pool
+    std::atomic<unsigned int> m_next_worker;
+
+    TaskGroup m_group;
+
+    // Guards the sleeping of idle and waiting threads
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+
+    bool m_stopping;
+};
+
+}   // namespace RadRt
+
+#endif // THREADPOOL_H_INCLUDED
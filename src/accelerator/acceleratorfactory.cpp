@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "acceleratorfactory.h"
+#include "bvh.h"
+#include "grid.h"
+#include "qbvh.h"
+#include "shapelist.h"
+#include <iostream>
+
+namespace RadRt
+{
+
+Accelerator *AcceleratorFactory::create(std::string classname)
+{
+    if (classname.compare("bvh") == 0)
+    {
+        return new Bvh();
+    }
+    else if (classname.compare("qbvh") == 0)
+    {
+        return new Qbvh();
+    }
+    else if (classname.compare("grid") == 0)
+    {
+        return new Grid();
+    }
+    else if (classname.compare("list") == 0)
+    {
+        return new ShapeList();
+    }
+    else
+    {
+        std::cerr << "Unknown Accelerator subclass: " << classname << std::endl;
+    }
+    return nullptr;
+}
+
+}   // namespace RadRt
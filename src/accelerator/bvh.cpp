@@ -0,0 +1,1282 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "bvh.h"
+#include "intersection.h"
+#include "ray.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace RadRt
+{
+
+// Largest number of shapes the builder will place in a single leaf.
+const unsigned int MAX_LEAF_SIZE = 4;
+
+// Relative costs of visiting a node and of intersecting a shape.
+const float TRAVERSAL_COST = 1.0;
+const float INTERSECTION_COST = 1.0;
+
+// Below this depth the builder falls back to median splits, which bounds
+// the size of the traversal stack.
+const int MAX_BUILD_DEPTH = 64;
+const int TRAVERSAL_STACK_SIZE = 128;
+
+// Scenes smaller than this are built on the calling thread.
+const unsigned int MIN_PARALLEL_PRIMITIVES = 4096;
+
+// Smallest number of primitives a worker handles in one pass over a node.
+const unsigned int PARALLEL_GRAIN = 16384;
+
+// Number of independent subtrees created per worker, so that uneven
+// subtrees still balance out.
+const unsigned int SUBTREES_PER_THREAD = 4;
+
+/**
+ * Get the threads building hierarchies that were not given a pool of their
+ * own, started on first use and kept for the rest of the process.
+ */
+static ThreadPool *shared_pool()
+{
+    static ThreadPool pool;
+    return &pool;
+}
+
+// A refitted hierarchy is rebuilt once its cost exceeds the cost it had when
+// built by this factor.
+const float REBUILD_COST_RATIO = 1.5;
+
+// Identifies saved hierarchies. The version must change whenever the layout
+// of the file or the meaning of its nodes does.
+const char CACHE_MAGIC[8] = { 'R', 'A', 'D', 'B', 'V', 'H', '\0', '\0' };
+const uint32_t CACHE_VERSION = 2;
+
+static inline float coordinate(const Point3d &p, int axis)
+{
+    return (axis == 0) ? p.x_coord() :
+           (axis == 1) ? p.y_coord() : p.z_coord();
+}
+
+static inline float component(const Vector3d &v, int axis)
+{
+    return (axis == 0) ? v.x_component() :
+           (axis == 1) ? v.y_component() : v.z_component();
+}
+
+int Bvh::bin_index(float centroid, float centroid_min, float scale)
+{
+    int bin = int((centroid - centroid_min) * scale);
+    return std::min(std::max(bin, 0), BIN_COUNT - 1);
+}
+
+Bvh::Bvh():
+    m_node_data(nullptr),
+    m_node_count(0),
+    m_mapping(nullptr),
+    m_mapping_size(0),
+    m_thread_pool(nullptr),
+    m_build_cost(0)
+{
+}
+
+Bvh::~Bvh()
+{
+    clear();
+}
+
+void Bvh::clear()
+{
+    if (m_mapping != nullptr)
+    {
+        munmap(m_mapping, m_mapping_size);
+        m_mapping = nullptr;
+        m_mapping_size = 0;
+    }
+
+    m_nodes.clear();
+    m_node_data = nullptr;
+    m_node_count = 0;
+    m_shapes.clear();
+    m_primitives.clear();
+    m_shape_indices.clear();
+    m_geometry.clear();
+    m_build_cost = 0;
+}
+
+void Bvh::build(const std::vector<Shape*> &shapes)
+{
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+    clear();
+
+    // Shapes made of several primitives, such as meshes, have each of
+    // them placed on its own
+    std::vector<Shape*> listed_shapes;
+    std::vector<unsigned int> listed_primitives;
+    GeometryStore::list_primitives(shapes, listed_shapes, listed_primitives);
+    unsigned int count = listed_shapes.size();
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Small scenes never start the shared pool
+    ThreadPool *pool = nullptr;
+    unsigned int thread_count = 1;
+    if (count >= MIN_PARALLEL_PRIMITIVES)
+    {
+        pool = (m_thread_pool != nullptr) ? m_thread_pool : shared_pool();
+        thread_count = pool->thread_count();
+    }
+
+    std::vector<Primitive> primitives(count);
+
+    // A binary tree over n leaves has 2n - 1 nodes
+    m_nodes.reserve(2 * count - 1);
+
+    if (thread_count == 1)
+    {
+        for (unsigned int index = 0; index < count; ++index)
+        {
+            init_primitive(primitives[index],
+                           listed_shapes[index]->primitive_bounds(
+                               listed_primitives[index]),
+                           index);
+        }
+
+        build_node(m_nodes, primitives, 0, primitives.size(), 0, nullptr);
+    }
+    else
+    {
+        pool->parallel_for(0, count, PARALLEL_GRAIN,
+            [&](unsigned int first, unsigned int last)
+            {
+                for (unsigned int index = first; index < last; ++index)
+                {
+                    init_primitive(primitives[index],
+                                   listed_shapes[index]->primitive_bounds(
+                                       listed_primitives[index]),
+                                   index);
+                }
+            });
+
+        // Split the top of the tree with its halves built as nested tasks,
+        // and the workers sharing each pass over the primitives, down to
+        // subtrees small enough for a single worker
+        std::vector<TopNode> top;
+        std::vector<Subtree> subtrees;
+        unsigned int subtree_size = std::max(
+            count / (SUBTREES_PER_THREAD * thread_count),
+            MIN_PARALLEL_PRIMITIVES / 2);
+        int root = build_top(top, subtrees, primitives, 0, primitives.size(),
+                             0, subtree_size, pool);
+
+        flatten(top, subtrees, root);
+    }
+
+    m_node_data = m_nodes.data();
+    m_node_count = m_nodes.size();
+    m_build_cost = cost();
+
+    m_shapes.resize(count);
+    m_primitives.resize(count);
+    m_shape_indices.resize(count);
+    for (unsigned int index = 0; index < count; ++index)
+    {
+        m_shapes[index] = listed_shapes[primitives[index].index];
+        m_primitives[index] = listed_primitives[primitives[index].index];
+        m_shape_indices[index] = primitives[index].index;
+    }
+    m_geometry.compile(m_shapes, m_primitives);
+
+    std::chrono::steady_clock::duration elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "bvh: " << count << " primitives, " << m_nodes.size()
+              << " nodes, " << thread_count << " threads, built in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     elapsed).count()
+              << " ms" << std::endl;
+}
+
+void Bvh::update(const std::vector<Shape*> &shapes)
+{
+    unsigned int count = 0;
+    for (unsigned int index = 0; index < shapes.size(); ++index)
+    {
+        count += shapes[index]->primitive_count();
+    }
+
+    if ((m_node_count == 0) || (count != m_shapes.size()))
+    {
+        build(shapes);
+        return;
+    }
+
+    // A loaded hierarchy is read-only, so take a copy to refit
+    if (m_mapping != nullptr)
+    {
+        m_nodes.assign(m_node_data, m_node_data + m_node_count);
+        munmap(m_mapping, m_mapping_size);
+        m_mapping = nullptr;
+        m_mapping_size = 0;
+        m_node_data = m_nodes.data();
+    }
+
+    if (m_build_cost == 0)
+    {
+        m_build_cost = cost();
+    }
+
+    // Children are stored after their parent, so a reverse pass visits both
+    // children of a node before the node itself
+    for (unsigned int node_index = m_node_count; node_index-- > 0; )
+    {
+        Node &node = m_nodes[node_index];
+
+        if (node.count > 0)
+        {
+            BoundingBox bounds;
+            for (unsigned int index = node.offset;
+                 index < node.offset + node.count; ++index)
+            {
+                bounds.expand(
+                    m_shapes[index]->primitive_bounds(m_primitives[index]));
+            }
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                node.min[axis] = bounds.min(axis);
+                node.max[axis] = bounds.max(axis);
+            }
+        }
+        else
+        {
+            const Node &left = m_nodes[node_index + 1];
+            const Node &right = m_nodes[node.offset];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                node.min[axis] = std::min(left.min[axis], right.min[axis]);
+                node.max[axis] = std::max(left.max[axis], right.max[axis]);
+            }
+        }
+    }
+
+    if (cost() > REBUILD_COST_RATIO * m_build_cost)
+    {
+        build(shapes);
+        return;
+    }
+
+    m_geometry.update();
+}
+
+float Bvh::cost() const
+{
+    if (m_node_count == 0)
+    {
+        return 0;
+    }
+
+    auto surface_area = [](const Node &node)
+    {
+        float dx = node.max[0] - node.min[0];
+        float dy = node.max[1] - node.min[1];
+        float dz = node.max[2] - node.min[2];
+        return 2 * (dx * dy + dy * dz + dz * dx);
+    };
+
+    float total = 0;
+    for (unsigned int node_index = 0; node_index < m_node_count; ++node_index)
+    {
+        const Node &node = m_node_data[node_index];
+        if (node.count > 0)
+        {
+            total += surface_area(node) * node.count * INTERSECTION_COST;
+        }
+        else
+        {
+            total += surface_area(node) * TRAVERSAL_COST;
+        }
+    }
+
+    // Relative to the root, the area of a node is the probability of a ray
+    // through the scene reaching it
+    float root_area = surface_area(m_node_data[0]);
+    return (root_area > 0) ? total / root_area : total;
+}
+
+void Bvh::init_primitive(Primitive &primitive, const BoundingBox &bounds,
+                         unsigned int index)
+{
+    primitive.bounds = bounds;
+    primitive.centroid = primitive.bounds.centroid();
+    primitive.index = index;
+}
+
+void Bvh::build_node(std::vector<Node> &nodes,
+                     std::vector<Primitive> &primitives,
+                     unsigned int begin, unsigned int end, int depth,
+                     ThreadPool *pool)
+{
+    unsigned int node_index = nodes.size();
+    nodes.push_back(Node());
+
+    BoundingBox bounds;
+    BoundingBox centroid_bounds;
+    compute_bounds(primitives, begin, end, bounds, centroid_bounds, pool);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        nodes[node_index].min[axis] = bounds.min(axis);
+        nodes[node_index].max[axis] = bounds.max(axis);
+    }
+
+    int axis;
+    unsigned int mid = split(primitives, begin, end, depth, bounds,
+                             centroid_bounds, axis, pool);
+
+    if (mid == begin)
+    {
+        // Leaf: the builder only reorders primitives within the range of
+        // the node, so the range maps directly onto the final shape array
+        nodes[node_index].offset = begin;
+        nodes[node_index].count = end - begin;
+        nodes[node_index].axis = 0;
+        return;
+    }
+
+    nodes[node_index].count = 0;
+    nodes[node_index].axis = axis;
+
+    build_node(nodes, primitives, begin, mid, depth + 1, pool);
+    nodes[node_index].offset = nodes.size();
+    build_node(nodes, primitives, mid, end, depth + 1, pool);
+}
+
+int Bvh::build_top(std::vector<TopNode> &top, std::vector<Subtree> &subtrees,
+                   std::vector<Primitive> &primitives,
+                   unsigned int begin, unsigned int end, int depth,
+                   unsigned int subtree_size, ThreadPool *pool)
+{
+    BoundingBox bounds;
+    BoundingBox centroid_bounds;
+    int axis;
+    unsigned int mid = begin;
+
+    if (end - begin > subtree_size)
+    {
+        compute_bounds(primitives, begin, end, bounds, centroid_bounds, pool);
+        mid = split(primitives, begin, end, depth, bounds, centroid_bounds,
+                    axis, pool);
+    }
+
+    if (mid == begin)
+    {
+        subtrees.push_back(Subtree());
+        build_node(subtrees.back().nodes, primitives, begin, end, depth,
+                   nullptr);
+        return -int(subtrees.size());
+    }
+
+    int node_index = top.size();
+    top.push_back(TopNode());
+    for (int dimension = 0; dimension < 3; ++dimension)
+    {
+        top[node_index].min[dimension] = bounds.min(dimension);
+        top[node_index].max[dimension] = bounds.max(dimension);
+    }
+    top[node_index].axis = axis;
+
+    // The halves cover disjoint ranges of primitives, so the right one is
+    // built concurrently into lists of its own, appended once it is done
+    std::vector<TopNode> right_top;
+    std::vector<Subtree> right_subtrees;
+    int right = 0;
+
+    ThreadPool::TaskGroup group;
+    pool->submit(group, [&]()
+        {
+            right = build_top(right_top, right_subtrees, primitives, mid, end,
+                              depth + 1, subtree_size, pool);
+        });
+
+    int left = build_top(top, subtrees, primitives, begin, mid, depth + 1,
+                         subtree_size, pool);
+    top[node_index].left = left;
+
+    pool->wait(group);
+
+    int top_base = top.size();
+    int subtree_base = subtrees.size();
+    for (unsigned int index = 0; index < right_top.size(); ++index)
+    {
+        TopNode node = right_top[index];
+        node.left = relocate(node.left, top_base, subtree_base);
+        node.right = relocate(node.right, top_base, subtree_base);
+        top.push_back(node);
+    }
+    for (unsigned int index = 0; index < right_subtrees.size(); ++index)
+    {
+        subtrees.push_back(Subtree());
+        subtrees.back().nodes.swap(right_subtrees[index].nodes);
+    }
+    top[node_index].right = relocate(right, top_base, subtree_base);
+
+    return node_index;
+}
+
+int Bvh::relocate(int reference, int top_base, int subtree_base)
+{
+    return (reference < 0) ? reference - subtree_base : reference + top_base;
+}
+
+void Bvh::flatten(const std::vector<TopNode> &top,
+                  const std::vector<Subtree> &subtrees, int reference)
+{
+    if (reference < 0)
+    {
+        // Subtrees use the same layout, so only the links to right
+        // children need moving
+        const std::vector<Node> &nodes = subtrees[-reference - 1].nodes;
+        unsigned int base = m_nodes.size();
+        for (unsigned int index = 0; index < nodes.size(); ++index)
+        {
+            m_nodes.push_back(nodes[index]);
+            if (nodes[index].count == 0)
+            {
+                m_nodes.back().offset += base;
+            }
+        }
+        return;
+    }
+
+    const TopNode &source = top[reference];
+    unsigned int node_index = m_nodes.size();
+    m_nodes.push_back(Node());
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_nodes[node_index].min[axis] = source.min[axis];
+        m_nodes[node_index].max[axis] = source.max[axis];
+    }
+    m_nodes[node_index].count = 0;
+    m_nodes[node_index].axis = source.axis;
+
+    flatten(top, subtrees, source.left);
+    m_nodes[node_index].offset = m_nodes.size();
+    flatten(top, subtrees, source.right);
+}
+
+void Bvh::compute_bounds(const std::vector<Primitive> &primitives,
+                         unsigned int begin, unsigned int end,
+                         BoundingBox &bounds, BoundingBox &centroid_bounds,
+                         ThreadPool *pool)
+{
+    if ((pool == nullptr) || (end - begin < PARALLEL_GRAIN))
+    {
+        for (unsigned int index = begin; index < end; ++index)
+        {
+            bounds.expand(primitives[index].bounds);
+            centroid_bounds.expand(primitives[index].centroid);
+        }
+        return;
+    }
+
+    std::mutex mutex;
+    pool->parallel_for(begin, end, PARALLEL_GRAIN,
+        [&](unsigned int first, unsigned int last)
+        {
+            BoundingBox chunk_bounds;
+            BoundingBox chunk_centroid_bounds;
+            for (unsigned int index = first; index < last; ++index)
+            {
+                chunk_bounds.expand(primitives[index].bounds);
+                chunk_centroid_bounds.expand(primitives[index].centroid);
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            bounds.expand(chunk_bounds);
+            centroid_bounds.expand(chunk_centroid_bounds);
+        });
+}
+
+void Bvh::fill_bins(const std::vector<Primitive> &primitives,
+                    unsigned int begin, unsigned int end,
+                    const BoundingBox &centroid_bounds, Bins &bins)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float extent = centroid_bounds.max(axis) - centroid_bounds.min(axis);
+        if (extent <= 0)
+        {
+            continue;
+        }
+
+        float scale = BIN_COUNT / extent;
+        for (unsigned int index = begin; index < end; ++index)
+        {
+            int bin = bin_index(coordinate(primitives[index].centroid, axis),
+                                centroid_bounds.min(axis), scale);
+            ++bins.count[axis][bin];
+            bins.bounds[axis][bin].expand(primitives[index].bounds);
+        }
+    }
+}
+
+unsigned int Bvh::split(std::vector<Primitive> &primitives,
+                        unsigned int begin, unsigned int end, int depth,
+                        const BoundingBox &bounds,
+                        const BoundingBox &centroid_bounds,
+                        int &axis, ThreadPool *pool)
+{
+    unsigned int count = end - begin;
+    axis = centroid_bounds.longest_axis();
+
+    if (count <= 1)
+    {
+        return begin;
+    }
+
+    if (depth >= MAX_BUILD_DEPTH)
+    {
+        if (count <= MAX_LEAF_SIZE)
+        {
+            return begin;
+        }
+
+        unsigned int mid = begin + count / 2;
+        int median_axis = axis;
+        std::nth_element(primitives.begin() + begin,
+                         primitives.begin() + mid,
+                         primitives.begin() + end,
+                         [median_axis](const Primitive &a, const Primitive &b)
+                         {
+                             return coordinate(a.centroid, median_axis) <
+                                    coordinate(b.centroid, median_axis);
+                         });
+        return mid;
+    }
+
+    Bins bins;
+    if ((pool == nullptr) || (count < PARALLEL_GRAIN))
+    {
+        fill_bins(primitives, begin, end, centroid_bounds, bins);
+    }
+    else
+    {
+        std::mutex mutex;
+        pool->parallel_for(begin, end, PARALLEL_GRAIN,
+            [&](unsigned int first, unsigned int last)
+            {
+                Bins chunk_bins;
+                fill_bins(primitives, first, last, centroid_bounds,
+                          chunk_bins);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                bins.merge(chunk_bins);
+            });
+    }
+
+    float leaf_cost = count * INTERSECTION_COST;
+    float parent_area = bounds.surface_area();
+
+    float best_cost = std::numeric_limits<float>::max();
+    int best_axis = -1;
+    int best_bin = 0;
+
+    for (int candidate = 0; candidate < 3; ++candidate)
+    {
+        // Sweep from the right to record the cost of every right-hand side
+        float right_cost[BIN_COUNT];
+        BoundingBox right_bounds;
+        unsigned int right_count = 0;
+        for (int bin = BIN_COUNT - 1; bin > 0; --bin)
+        {
+            right_bounds.expand(bins.bounds[candidate][bin]);
+            right_count += bins.count[candidate][bin];
+            right_cost[bin] = right_count * right_bounds.surface_area();
+        }
+
+        // Then sweep from the left, splitting after each bin
+        BoundingBox left_bounds;
+        unsigned int left_count = 0;
+        for (int bin = 0; bin < BIN_COUNT - 1; ++bin)
+        {
+            left_bounds.expand(bins.bounds[candidate][bin]);
+            left_count += bins.count[candidate][bin];
+
+            if ((left_count == 0) || (left_count == count))
+            {
+                continue;
+            }
+
+            float cost = TRAVERSAL_COST + INTERSECTION_COST *
+                (left_count * left_bounds.surface_area() +
+                 right_cost[bin + 1]) / parent_area;
+
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = candidate;
+                best_bin = bin;
+            }
+        }
+    }
+
+    if (best_axis < 0)
+    {
+        // Every centroid coincides; binning cannot separate these shapes
+        if (count <= MAX_LEAF_SIZE)
+        {
+            return begin;
+        }
+        axis = bounds.longest_axis();
+        return begin + count / 2;
+    }
+
+    if ((count <= MAX_LEAF_SIZE) && (leaf_cost <= best_cost))
+    {
+        return begin;
+    }
+
+    axis = best_axis;
+    float centroid_min = centroid_bounds.min(best_axis);
+    float scale = BIN_COUNT / (centroid_bounds.max(best_axis) - centroid_min);
+
+    std::vector<Primitive>::iterator mid = std::partition(
+        primitives.begin() + begin,
+        primitives.begin() + end,
+        [=](const Primitive &p)
+        {
+            return bin_index(coordinate(p.centroid, best_axis),
+                             centroid_min, scale) <= best_bin;
+        });
+
+    return mid - primitives.begin();
+}
+
+inline bool Bvh::intersect_node(const Node &node,
+                                const float origin[3],
+                                const float inverse_direction[3],
+                                float t_min, float t_max) const
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t0 = (node.min[axis] - origin[axis]) * inverse_direction[axis];
+        float t1 = (node.max[axis] - origin[axis]) * inverse_direction[axis];
+
+        if (t0 > t1)
+        {
+            std::swap(t0, t1);
+        }
+
+        t_min = std::max(t_min, t0);
+        t_max = std::min(t_max, t1);
+
+        if (t_min > t_max)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool Bvh::intersect_node(const Node &node,
+                                const Packet &packet) const
+{
+    // Every ray enters the node no earlier than the bounds give, and leaves
+    // it no later, along each axis
+    float t_min = packet.t_min_min;
+    float t_max = packet.t_max_max;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float to_min = node.min[axis] - packet.origin[axis];
+        float to_max = node.max[axis] - packet.origin[axis];
+        float t0 = to_min * packet.inverse_min[axis];
+        float t1 = to_min * packet.inverse_max[axis];
+        float t2 = to_max * packet.inverse_min[axis];
+        float t3 = to_max * packet.inverse_max[axis];
+
+        t_min = std::max(t_min, std::min(std::min(t0, t1), std::min(t2, t3)));
+        t_max = std::min(t_max, std::max(std::max(t0, t1), std::max(t2, t3)));
+    }
+    return t_min <= t_max;
+}
+
+inline int Bvh::intersect_node(const Node &node, const Packet &packet,
+                               int lane) const
+{
+#ifdef __SSE__
+    __m128 t_min = _mm_loadu_ps(&packet.t_min[lane]);
+    __m128 t_max = _mm_loadu_ps(&packet.t_max[lane]);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        __m128 inverse = _mm_loadu_ps(&packet.inverse_direction[axis][lane]);
+        __m128 t0 = _mm_mul_ps(
+            _mm_set1_ps(node.min[axis] - packet.origin[axis]), inverse);
+        __m128 t1 = _mm_mul_ps(
+            _mm_set1_ps(node.max[axis] - packet.origin[axis]), inverse);
+
+        // The operands are ordered so that a NaN, from a zero direction
+        // component, is ignored just as in the scalar test
+        t_min = _mm_max_ps(_mm_min_ps(t1, t0), t_min);
+        t_max = _mm_min_ps(_mm_max_ps(t0, t1), t_max);
+    }
+    return _mm_movemask_ps(_mm_cmple_ps(t_min, t_max));
+#else
+    int mask = 0;
+    for (int offset = 0; offset < 4; ++offset)
+    {
+        float inverse_direction[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            inverse_direction[axis] =
+                packet.inverse_direction[axis][lane + offset];
+        }
+        if (intersect_node(node, packet.origin, inverse_direction,
+                           packet.t_min[lane + offset],
+                           packet.t_max[lane + offset]))
+        {
+            mask |= 1 << offset;
+        }
+    }
+    return mask;
+#endif
+}
+
+bool Bvh::closest_intersection(const Ray &ray, Intersection &hit) const
+{
+    if (m_node_count == 0)
+    {
+        return false;
+    }
+
+    Vector3d direction = ray.direction();
+
+    float origin[3];
+    float inverse_direction[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        origin[axis] = coordinate(ray.vertex(), axis);
+        inverse_direction[axis] = 1.0f / component(direction, axis);
+    }
+
+    // Each hit shortens the ray, so that nodes and shapes beyond it are
+    // culled
+    Ray bounded = ray;
+    return intersect_subtree(0, origin, inverse_direction, bounded, hit);
+}
+
+bool Bvh::intersect_subtree(unsigned int root, const float origin[3],
+                            const float inverse_direction[3], Ray &bounded,
+                            Intersection &hit) const
+{
+    bool found = false;
+
+    unsigned int stack[TRAVERSAL_STACK_SIZE];
+    int stack_size = 0;
+    unsigned int node_index = root;
+
+    while (true)
+    {
+        const Node &node = m_node_data[node_index];
+
+        if (intersect_node(node, origin, inverse_direction, bounded.t_min(),
+                           bounded.t_max()))
+        {
+            if (node.count > 0)
+            {
+                if (m_geometry.intersect(bounded, node.offset,
+                                         node.offset + node.count, hit))
+                {
+                    bounded.set_t_max(hit.t());
+                    found = true;
+                }
+            }
+            else
+            {
+                // Visit the child nearer to the ray origin first
+                if (inverse_direction[node.axis] < 0)
+                {
+                    stack[stack_size++] = node_index + 1;
+                    node_index = node.offset;
+                }
+                else
+                {
+                    stack[stack_size++] = node.offset;
+                    node_index = node_index + 1;
+                }
+                continue;
+            }
+        }
+
+        if (stack_size == 0)
+        {
+            break;
+        }
+        node_index = stack[--stack_size];
+    }
+
+    return found;
+}
+
+void Bvh::closest_intersections(const RayPacket &packet, Intersection hits[],
+                                bool found[]) const
+{
+    for (int index = 0; index < packet.size(); ++index)
+    {
+        found[index] = false;
+    }
+    if ((m_node_count == 0) || (packet.size() == 0))
+    {
+        return;
+    }
+
+    Packet rays;
+    rays.size = packet.size();
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        rays.origin[axis] = coordinate(packet.ray(0).vertex(), axis);
+    }
+
+    // Children are visited in an order shared by the whole packet, which
+    // is that of each single ray only if their directions agree in sign
+    bool coherent = true;
+    rays.bounded = true;
+    for (int index = 0; index < rays.size; ++index)
+    {
+        const Ray &ray = packet.ray(index);
+        Vector3d direction = ray.direction();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float inverse = 1.0f / component(direction, axis);
+            rays.inverse_direction[axis][index] = inverse;
+
+            if (index == 0)
+            {
+                rays.negative[axis] = (inverse < 0);
+                rays.inverse_min[axis] = inverse;
+                rays.inverse_max[axis] = inverse;
+            }
+            coherent = coherent &&
+                       (coordinate(ray.vertex(), axis) == rays.origin[axis]) &&
+                       ((inverse < 0) == rays.negative[axis]);
+            rays.bounded = rays.bounded &&
+                           (std::fabs(inverse) <=
+                            std::numeric_limits<float>::max());
+            rays.inverse_min[axis] = std::min(rays.inverse_min[axis],
+                                              inverse);
+            rays.inverse_max[axis] = std::max(rays.inverse_max[axis],
+                                              inverse);
+        }
+        rays.t_min[index] = ray.t_min();
+        rays.t_max[index] = ray.t_max();
+    }
+
+    if (!coherent)
+    {
+        Accelerator::closest_intersections(packet, hits, found);
+        return;
+    }
+
+    // Pad to a whole number of groups of four with rays that miss
+    // everything
+    for (int index = rays.size; index % 4 != 0; ++index)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            rays.inverse_direction[axis][index] = 1;
+        }
+        rays.t_min[index] = 1;
+        rays.t_max[index] = 0;
+    }
+
+    rays.t_min_min = *std::min_element(rays.t_min, rays.t_min + rays.size);
+    rays.t_max_max = *std::max_element(rays.t_max, rays.t_max + rays.size);
+
+    // Each stack entry carries the rays that reached it, so that a ray only
+    // ever visits the nodes it would visit alone, in the same order
+    unsigned int stack[TRAVERSAL_STACK_SIZE];
+    uint64_t stack_rays[TRAVERSAL_STACK_SIZE];
+    int stack_size = 0;
+    unsigned int node_index = 0;
+    uint64_t active = (rays.size == 64) ? ~uint64_t(0) :
+                                          (uint64_t(1) << rays.size) - 1;
+
+    while (true)
+    {
+        const Node &node = m_node_data[node_index];
+
+        uint64_t hit_rays = 0;
+        if (!rays.bounded || intersect_node(node, rays))
+        {
+            for (int lane = 0; lane < rays.size; lane += 4)
+            {
+                if ((active >> lane) & 0xf)
+                {
+                    hit_rays |= uint64_t(intersect_node(node, rays, lane))
+                                << lane;
+                }
+            }
+            hit_rays &= active;
+        }
+
+        if ((hit_rays != 0) && ((hit_rays & (hit_rays - 1)) == 0))
+        {
+            // A single ray is left, which carries on through the subtree
+            // alone
+            int lane = 0;
+            while (!((hit_rays >> lane) & 1))
+            {
+                ++lane;
+            }
+
+            const Ray &ray = packet.ray(lane);
+            float inverse_direction[3];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                inverse_direction[axis] = rays.inverse_direction[axis][lane];
+            }
+            Ray bounded(ray.vertex(), ray.direction(), rays.t_min[lane],
+                        rays.t_max[lane]);
+            if (intersect_subtree(node_index, rays.origin, inverse_direction,
+                                  bounded, hits[lane]))
+            {
+                rays.t_max[lane] = bounded.t_max();
+                found[lane] = true;
+            }
+        }
+        else if (hit_rays != 0)
+        {
+            if (node.count > 0)
+            {
+                for (int lane = 0; lane < rays.size; ++lane)
+                {
+                    if (!((hit_rays >> lane) & 1))
+                    {
+                        continue;
+                    }
+
+                    const Ray &ray = packet.ray(lane);
+                    Ray bounded(ray.vertex(), ray.direction(),
+                                rays.t_min[lane], rays.t_max[lane]);
+                    if (m_geometry.intersect(bounded, node.offset,
+                                             node.offset + node.count,
+                                             hits[lane]))
+                    {
+                        rays.t_max[lane] = hits[lane].t();
+                        found[lane] = true;
+                    }
+                }
+                rays.t_max_max = *std::max_element(rays.t_max,
+                                                   rays.t_max + rays.size);
+            }
+            else
+            {
+                // Visit the child nearer to the ray origin first
+                if (rays.negative[node.axis])
+                {
+                    stack[stack_size] = node_index + 1;
+                    node_index = node.offset;
+                }
+                else
+                {
+                    stack[stack_size] = node.offset;
+                    node_index = node_index + 1;
+                }
+                stack_rays[stack_size++] = hit_rays;
+                active = hit_rays;
+                continue;
+            }
+        }
+
+        if (stack_size == 0)
+        {
+            break;
+        }
+        --stack_size;
+        node_index = stack[stack_size];
+        active = stack_rays[stack_size];
+    }
+}
+
+bool Bvh::occluded(const Ray &ray, const Intersection *from,
+                   float &transmission) const
+{
+    if (m_node_count == 0)
+    {
+        return false;
+    }
+
+    Vector3d direction = ray.direction();
+
+    float origin[3];
+    float inverse_direction[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        origin[axis] = coordinate(ray.vertex(), axis);
+        inverse_direction[axis] = 1.0f / component(direction, axis);
+    }
+
+    unsigned int stack[TRAVERSAL_STACK_SIZE];
+    int stack_size = 0;
+    unsigned int node_index = 0;
+
+    while (true)
+    {
+        const Node &node = m_node_data[node_index];
+
+        if (intersect_node(node, origin, inverse_direction, ray.t_min(),
+                           ray.t_max()))
+        {
+            if (node.count > 0)
+            {
+                if (m_geometry.occluded(ray, node.offset,
+                                        node.offset + node.count, from,
+                                        transmission))
+                {
+                    return true;
+                }
+            }
+            else
+            {
+                // Any hit will do, so the child order does not matter
+                stack[stack_size++] = node.offset;
+                node_index = node_index + 1;
+                continue;
+            }
+        }
+
+        if (stack_size == 0)
+        {
+            break;
+        }
+        node_index = stack[--stack_size];
+    }
+
+    return false;
+}
+
+BoundingBox Bvh::bounds() const
+{
+    if (m_node_count == 0)
+    {
+        return BoundingBox();
+    }
+
+    const Node &root = m_node_data[0];
+    return BoundingBox(Point3d(root.min[0], root.min[1], root.min[2]),
+                       Point3d(root.max[0], root.max[1], root.max[2]));
+}
+
+bool Bvh::save(const std::string &filename, uint64_t key) const
+{
+    // Only built hierarchies know the original shape order
+    if ((m_node_count == 0) || m_shape_indices.empty())
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.node_size = sizeof(Node);
+    header.key = key;
+    header.shape_count = m_shape_indices.size();
+    header.node_count = m_node_count;
+
+    // Write to a temporary file first, so that an interrupted save never
+    // leaves a truncated cache behind
+    std::string temporary = filename + ".tmp";
+    std::ofstream out(temporary.c_str(), std::ios::out | std::ios::binary |
+                                         std::ios::trunc);
+    if (!out)
+    {
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(m_node_data),
+              m_node_count * sizeof(Node));
+    out.write(reinterpret_cast<const char*>(m_shape_indices.data()),
+              m_shape_indices.size() * sizeof(unsigned int));
+    out.close();
+
+    if (!out || (std::rename(temporary.c_str(), filename.c_str()) != 0))
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Bvh::valid_nodes(const Node nodes[], unsigned int node_count,
+                      unsigned int shape_count)
+{
+    // Depth first from the root, as traversal goes, counting the nodes
+    // reached so that nodes shared between subtrees are caught
+    std::vector<std::pair<unsigned int, int> > stack;
+    stack.push_back(std::make_pair(0u, 0));
+    unsigned int reached = 0;
+
+    while (!stack.empty())
+    {
+        unsigned int index = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+
+        if ((++reached > node_count) || (depth >= TRAVERSAL_STACK_SIZE))
+        {
+            return false;
+        }
+
+        const Node &node = nodes[index];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (std::isnan(node.min[axis]) || std::isnan(node.max[axis]))
+            {
+                return false;
+            }
+        }
+
+        if (node.count > 0)
+        {
+            if (uint64_t(node.offset) + node.count > shape_count)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        if ((node.axis >= 3) || (index + 1 >= node_count) ||
+            (node.offset <= index + 1) || (node.offset >= node_count))
+        {
+            return false;
+        }
+        stack.push_back(std::make_pair(node.offset, depth + 1));
+        stack.push_back(std::make_pair(index + 1, depth + 1));
+    }
+
+    return reached == node_count;
+}
+
+bool Bvh::load(const std::string &filename, uint64_t key,
+               const std::vector<Shape*> &shapes)
+{
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if ((fstat(fd, &status) != 0) ||
+        (size_t(status.st_size) < sizeof(CacheHeader)))
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = status.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const char *data = static_cast<const char*>(mapping);
+    const CacheHeader *header = reinterpret_cast<const CacheHeader*>(data);
+
+    // The cache orders primitives, not shapes
+    std::vector<Shape*> listed_shapes;
+    std::vector<unsigned int> listed_primitives;
+    GeometryStore::list_primitives(shapes, listed_shapes, listed_primitives);
+
+    bool valid =
+        (std::memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0) &&
+        (header->version == CACHE_VERSION) &&
+        (header->node_size == sizeof(Node)) &&
+        (header->key == key) &&
+        (header->shape_count == listed_shapes.size()) &&
+        (header->node_count > 0) &&
+        (size == sizeof(CacheHeader) + header->node_count * sizeof(Node) +
+                 header->shape_count * sizeof(unsigned int));
+
+    const Node *nodes =
+        reinterpret_cast<const Node*>(data + sizeof(CacheHeader));
+    const unsigned int *indices = reinterpret_cast<const unsigned int*>(
+        data + sizeof(CacheHeader) + header->node_count * sizeof(Node));
+
+    for (unsigned int index = 0; valid && index < header->shape_count;
+         ++index)
+    {
+        valid = indices[index] < listed_shapes.size();
+    }
+
+    valid = valid && valid_nodes(nodes, header->node_count,
+                                 header->shape_count);
+
+    if (!valid)
+    {
+        munmap(mapping, size);
+        return false;
+    }
+
+    clear();
+
+    m_mapping = mapping;
+    m_mapping_size = size;
+    m_node_data = nodes;
+    m_node_count = header->node_count;
+
+    m_shapes.resize(listed_shapes.size());
+    m_primitives.resize(listed_shapes.size());
+    for (unsigned int index = 0; index < m_shapes.size(); ++index)
+    {
+        m_shapes[index] = listed_shapes[indices[index]];
+        m_primitives[index] = listed_primitives[indices[index]];
+    }
+    m_geometry.compile(m_shapes, m_primitives);
+
+    std::chrono::steady_clock::duration elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "bvh: " << listed_shapes.size() << " primitives, "
+              << m_node_count
+              << " nodes, loaded from " << filename << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     elapsed).count()
+              << " ms" << std::endl;
+
+    return true;
+}
+
+}   // namespace RadRt
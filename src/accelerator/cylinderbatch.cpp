@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "cylinderbatch.h"
+#include "cylinder.h"
+#include "intersection.h"
+#include "ray.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace RadRt
+{
+
+namespace
+{
+
+#ifdef __SSE__
+/**
+ * Take lanes of a where the mask is set, and of b elsewhere.
+ */
+inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+}   // namespace
+
+void CylinderBatch::assign(const std::vector<Cylinder*> &cylinders)
+{
+    m_cylinders = cylinders;
+
+    // An infinitely negative squared radius makes every ray miss, so that
+    // the padding is never hit
+    unsigned int size = cylinders.size() + PADDING;
+    m_base_x.assign(size, 0);
+    m_base_y.assign(size, 0);
+    m_base_z.assign(size, 0);
+    m_axis_x.assign(size, 0);
+    m_axis_y.assign(size, 0);
+    m_axis_z.assign(size, 0);
+    m_height.assign(size, 0);
+    m_radius_squared.assign(size, -std::numeric_limits<float>::infinity());
+
+    update();
+}
+
+void CylinderBatch::update()
+{
+    for (unsigned int index = 0; index < m_cylinders.size(); ++index)
+    {
+        const Cylinder *cylinder = m_cylinders[index];
+        m_base_x[index] = cylinder->base().x_coord();
+        m_base_y[index] = cylinder->base().y_coord();
+        m_base_z[index] = cylinder->base().z_coord();
+        m_axis_x[index] = cylinder->axis().x_component();
+        m_axis_y[index] = cylinder->axis().y_component();
+        m_axis_z[index] = cylinder->axis().z_component();
+        m_height[index] = cylinder->height();
+        m_radius_squared[index] = cylinder->radius() * cylinder->radius();
+    }
+}
+
+void CylinderBatch::clear()
+{
+    m_cylinders.clear();
+    m_base_x.clear();
+    m_base_y.clear();
+    m_base_z.clear();
+    m_axis_x.clear();
+    m_axis_y.clear();
+    m_axis_z.clear();
+    m_height.clear();
+    m_radius_squared.clear();
+}
+
+inline int CylinderBatch::test(const Ray &ray, unsigned int index,
+                               unsigned int end, float t_max,
+                               float t[4]) const
+{
+    // The arithmetic follows Cylinder::intersect step by step, so that both
+    // find exactly the same distances
+    const Point3d &vertex = ray.vertex();
+    const Vector3d &direction = ray.direction();
+    float direction_squared = dot_product(direction, direction);
+    float t_min = ray.t_min();
+
+#ifdef __SSE__
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    __m128 dx = _mm_set1_ps(direction.x_component());
+    __m128 dy = _mm_set1_ps(direction.y_component());
+    __m128 dz = _mm_set1_ps(direction.z_component());
+    __m128 t_min4 = _mm_set1_ps(t_min);
+    __m128 zero = _mm_setzero_ps();
+    __m128 plus_infinity = _mm_set1_ps(infinity);
+    __m128 minus_infinity = _mm_set1_ps(-infinity);
+
+    __m128 offset_x = _mm_sub_ps(_mm_set1_ps(vertex.x_coord()),
+                                 _mm_loadu_ps(&m_base_x[index]));
+    __m128 offset_y = _mm_sub_ps(_mm_set1_ps(vertex.y_coord()),
+                                 _mm_loadu_ps(&m_base_y[index]));
+    __m128 offset_z = _mm_sub_ps(_mm_set1_ps(vertex.z_coord()),
+                                 _mm_loadu_ps(&m_base_z[index]));
+    __m128 axis_x = _mm_loadu_ps(&m_axis_x[index]);
+    __m128 axis_y = _mm_loadu_ps(&m_axis_y[index]);
+    __m128 axis_z = _mm_loadu_ps(&m_axis_z[index]);
+    __m128 height = _mm_loadu_ps(&m_height[index]);
+
+    __m128 d_axial = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, axis_x),
+                                           _mm_mul_ps(dy, axis_y)),
+                                _mm_mul_ps(dz, axis_z));
+    __m128 o_axial = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offset_x, axis_x),
+                                           _mm_mul_ps(offset_y, axis_y)),
+                                _mm_mul_ps(offset_z, axis_z));
+
+    __m128 a = _mm_sub_ps(_mm_set1_ps(direction_squared),
+                          _mm_mul_ps(d_axial, d_axial));
+    __m128 b = _mm_sub_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, offset_x),
+                              _mm_mul_ps(dy, offset_y)),
+                   _mm_mul_ps(dz, offset_z)),
+        _mm_mul_ps(d_axial, o_axial));
+    __m128 c = _mm_sub_ps(
+        _mm_sub_ps(
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(offset_x, offset_x),
+                                  _mm_mul_ps(offset_y, offset_y)),
+                       _mm_mul_ps(offset_z, offset_z)),
+            _mm_mul_ps(o_axial, o_axial)),
+        _mm_loadu_ps(&m_radius_squared[index]));
+
+    // Infinite cylinder, or the whole line for rays parallel to the axis
+    // inside it
+    __m128 parallel = _mm_cmpeq_ps(a, zero);
+    __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+    __m128 root = _mm_sqrt_ps(discriminant);
+    __m128 minus_b = _mm_sub_ps(zero, b);
+    __m128 t_enter = select(parallel, minus_infinity,
+        _mm_div_ps(_mm_sub_ps(minus_b, root), a));
+    __m128 t_exit = select(parallel, plus_infinity,
+        _mm_div_ps(_mm_add_ps(minus_b, root), a));
+    __m128 valid = select(parallel, _mm_cmplt_ps(c, zero),
+                          _mm_cmpge_ps(discriminant, zero));
+
+    // Slab between the endcaps, or all of it for rays parallel to the
+    // endcaps between them
+    __m128 flat = _mm_cmpeq_ps(d_axial, zero);
+    __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), d_axial);
+    __m128 t0 = _mm_mul_ps(_mm_sub_ps(zero, o_axial), inverse);
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(height, o_axial), inverse);
+    t_enter = _mm_max_ps(t_enter,
+                         select(flat, minus_infinity, _mm_min_ps(t0, t1)));
+    t_exit = _mm_min_ps(t_exit,
+                        select(flat, plus_infinity, _mm_max_ps(t0, t1)));
+    valid = _mm_and_ps(valid, select(flat,
+        _mm_and_ps(_mm_cmpge_ps(o_axial, zero),
+                   _mm_cmple_ps(o_axial, height)),
+        _mm_cmpeq_ps(zero, zero)));
+
+    __m128 distance = select(_mm_cmpge_ps(t_enter, t_min4), t_enter, t_exit);
+    valid = _mm_and_ps(valid, _mm_cmple_ps(t_enter, t_exit));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(distance, t_min4));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(distance, _mm_set1_ps(t_max)));
+
+    int mask = _mm_movemask_ps(valid);
+    _mm_storeu_ps(t, distance);
+#else
+    int mask = 0;
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        unsigned int slot = index + lane;
+        float offset_x = vertex.x_coord() - m_base_x[slot];
+        float offset_y = vertex.y_coord() - m_base_y[slot];
+        float offset_z = vertex.z_coord() - m_base_z[slot];
+        float axis_x = m_axis_x[slot];
+        float axis_y = m_axis_y[slot];
+        float axis_z = m_axis_z[slot];
+        float height = m_height[slot];
+
+        float d_axial = direction.x_component() * axis_x +
+                        direction.y_component() * axis_y +
+                        direction.z_component() * axis_z;
+        float o_axial = offset_x * axis_x + offset_y * axis_y +
+                        offset_z * axis_z;
+
+        float a = direction_squared - d_axial * d_axial;
+        float b = (direction.x_component() * offset_x +
+                   direction.y_component() * offset_y +
+                   direction.z_component() * offset_z) - d_axial * o_axial;
+        float c = ((offset_x * offset_x + offset_y * offset_y +
+                    offset_z * offset_z) - o_axial * o_axial) -
+                  m_radius_squared[slot];
+
+        float t_enter;
+        float t_exit;
+        if (a == 0)
+        {
+            if (c >= 0)
+            {
+                continue;
+            }
+            t_enter = -std::numeric_limits<float>::infinity();
+            t_exit = std::numeric_limits<float>::infinity();
+        }
+        else
+        {
+            float discriminant = b * b - a * c;
+            if (discriminant < 0)
+            {
+                continue;
+            }
+
+            float root = std::sqrt(discriminant);
+            t_enter = (-b - root) / a;
+            t_exit = (-b + root) / a;
+        }
+
+        if (d_axial == 0)
+        {
+            if ((o_axial < 0) || (o_axial > height))
+            {
+                continue;
+            }
+        }
+        else
+        {
+            float inverse = 1.0f / d_axial;
+            float t0 = (0 - o_axial) * inverse;
+            float t1 = (height - o_axial) * inverse;
+            t_enter = std::max(t_enter, std::min(t0, t1));
+            t_exit = std::min(t_exit, std::max(t0, t1));
+        }
+
+        float distance = (t_enter >= t_min) ? t_enter : t_exit;
+        if ((t_enter <= t_exit) && (distance >= t_min) &&
+            (distance <= t_max))
+        {
+            t[lane] = distance;
+            mask |= 1 << lane;
+        }
+    }
+#endif
+
+    if (end - index < 4)
+    {
+        mask &= (1 << (end - index)) - 1;
+    }
+    return mask;
+}
+
+bool CylinderBatch::intersect(const Ray &ray, unsigned int begin,
+                              unsigned int end, Intersection &hit) const
+{
+    float t_max = ray.t_max();
+    int closest = -1;
+
+    for (unsigned int index = begin; index < end; index += 4)
+    {
+        float t[4];
+        int mask = test(ray, index, end, t_max, t);
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            if ((mask & 1) && (t[lane] <= t_max))
+            {
+                t_max = t[lane];
+                closest = index + lane;
+            }
+        }
+    }
+
+    if (closest < 0)
+    {
+        return false;
+    }
+
+    m_cylinders[closest]->intersection_at(ray, t_max, hit);
+    return true;
+}
+
+bool CylinderBatch::occluded(const Ray &ray, unsigned int begin,
+                             unsigned int end, const Shape *origin,
+                             float &transmission) const
+{
+    for (unsigned int index = begin; index < end; index += 4)
+    {
+        float t[4];
+        int mask = test(ray, index, end, ray.t_max(), t);
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            const Cylinder *cylinder = m_cylinders[index + lane];
+            if (!(mask & 1) || (cylinder == origin))
+            {
+                continue;
+            }
+
+            if (cylinder->transmissive_constant() <= 0)
+            {
+                return true;
+            }
+            transmission *= cylinder->transmissive_constant();
+        }
+    }
+
+    return false;
+}
+
+}   // namespace RadRt
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "geometrystore.h"
+#include "cylinder.h"
+#include "intersection.h"
+#include "mesh.h"
+#include "ray.h"
+#include "rectangle.h"
+#include "sphere.h"
+
+namespace RadRt
+{
+
+GeometryStore::ShapeType GeometryStore::type_of(Shape *shape)
+{
+    if (dynamic_cast<Sphere*>(shape) != nullptr)
+    {
+        return SPHERE;
+    }
+    if (dynamic_cast<Cylinder*>(shape) != nullptr)
+    {
+        return CYLINDER;
+    }
+    if (dynamic_cast<Rectangle*>(shape) != nullptr)
+    {
+        return RECTANGLE;
+    }
+    if (dynamic_cast<Mesh*>(shape) != nullptr)
+    {
+        return TRIANGLE;
+    }
+    return OTHER;
+}
+
+void GeometryStore::list_primitives(const std::vector<Shape*> &shapes,
+                                    std::vector<Shape*> &primitive_shapes,
+                                    std::vector<unsigned int> &primitives)
+{
+    primitive_shapes.clear();
+    primitives.clear();
+
+    for (unsigned int index = 0; index < shapes.size(); ++index)
+    {
+        unsigned int count = shapes[index]->primitive_count();
+        for (unsigned int primitive = 0; primitive < count; ++primitive)
+        {
+            primitive_shapes.push_back(shapes[index]);
+            primitives.push_back(primitive);
+        }
+    }
+}
+
+void GeometryStore::compile(const std::vector<Shape*> &shapes,
+                            const std::vector<unsigned int> &primitives)
+{
+    std::vector<Sphere*> spheres;
+    std::vector<Cylinder*> cylinders;
+    std::vector<Rectangle*> rectangles;
+    std::vector<Mesh*> meshes;
+    std::vector<unsigned int> triangles;
+    m_others.clear();
+
+    for (int type = 0; type < SHAPE_TYPE_COUNT; ++type)
+    {
+        m_first[type].assign(shapes.size() + 1, 0);
+    }
+
+    ShapeType type = OTHER;
+    for (unsigned int index = 0; index < shapes.size(); ++index)
+    {
+        // Primitives of one shape mostly sit next to each other, so the
+        // type is only looked up when the shape changes
+        Shape *shape = shapes[index];
+        if ((index == 0) || (shape != shapes[index - 1]))
+        {
+            type = type_of(shape);
+        }
+        switch (type)
+        {
+            case SPHERE:
+                spheres.push_back(static_cast<Sphere*>(shape));
+                break;
+            case CYLINDER:
+                cylinders.push_back(static_cast<Cylinder*>(shape));
+                break;
+            case RECTANGLE:
+                rectangles.push_back(static_cast<Rectangle*>(shape));
+                break;
+            case TRIANGLE:
+                meshes.push_back(static_cast<Mesh*>(shape));
+                triangles.push_back(primitives[index]);
+                break;
+            default:
+                m_others.push_back(shape);
+                break;
+        }
+
+        for (int other = 0; other < SHAPE_TYPE_COUNT; ++other)
+        {
+            m_first[other][index + 1] = m_first[other][index] +
+                                        (other == type);
+        }
+    }
+
+    m_spheres.assign(spheres);
+    m_cylinders.assign(cylinders);
+    m_rectangles.assign(rectangles);
+    m_triangles.assign(meshes, triangles);
+}
+
+void GeometryStore::update()
+{
+    m_spheres.update();
+    m_cylinders.update();
+    m_rectangles.update();
+    m_triangles.update();
+}
+
+void GeometryStore::clear()
+{
+    for (int type = 0; type < SHAPE_TYPE_COUNT; ++type)
+    {
+        m_first[type].clear();
+    }
+
+    m_spheres.clear();
+    m_cylinders.clear();
+    m_rectangles.clear();
+    m_triangles.clear();
+    m_others.clear();
+}
+
+bool GeometryStore::intersect(const Ray &ray, unsigned int begin,
+                              unsigned int end, Intersection &hit) const
+{
+    // Each hit shortens the ray, so that the batches after it only report
+    // nearer ones
+    Ray bounded = ray;
+    bool found = false;
+
+    if (m_spheres.intersect(bounded, m_first[SPHERE][begin],
+                            m_first[SPHERE][end], hit))
+    {
+        bounded.set_t_max(hit.t());
+        found = true;
+    }
+    if (m_cylinders.intersect(bounded, m_first[CYLINDER][begin],
+                              m_first[CYLINDER][end], hit))
+    {
+        bounded.set_t_max(hit.t());
+        found = true;
+    }
+    if (m_rectangles.intersect(bounded, m_first[RECTANGLE][begin],
+                               m_first[RECTANGLE][end], hit))
+    {
+        bounded.set_t_max(hit.t());
+        found = true;
+    }
+    if (m_triangles.intersect(bounded, m_first[TRIANGLE][begin],
+                              m_first[TRIANGLE][end], hit))
+    {
+        bounded.set_t_max(hit.t());
+        found = true;
+    }
+
+    for (unsigned int index = m_first[OTHER][begin];
+         index < m_first[OTHER][end]; ++index)
+    {
+        if (m_others[index]->intersect(bounded, hit))
+        {
+            bounded.set_t_max(hit.t());
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+bool GeometryStore::occluded(const Ray &ray, unsigned int begin,
+                             unsigned int end, const Intersection *origin,
+                             float &transmission) const
+{
+    const Shape *origin_shape = (origin != nullptr) ?
+                                    origin->intersected_shape() : nullptr;
+
+    if (m_spheres.occluded(ray, m_first[SPHERE][begin],
+                           m_first[SPHERE][end], origin_shape,
+                           transmission) ||
+        m_cylinders.occluded(ray, m_first[CYLINDER][begin],
+                             m_first[CYLINDER][end], origin_shape,
+                             transmission) ||
+        m_rectangles.occluded(ray, m_first[RECTANGLE][begin],
+                              m_first[RECTANGLE][end], origin_shape,
+                              transmission) ||
+        m_triangles.occluded(ray, m_first[TRIANGLE][begin],
+                             m_first[TRIANGLE][end], transmission))
+    {
+        return true;
+    }
+
+    for (unsigned int index = m_first[OTHER][begin];
+         index < m_first[OTHER][end]; ++index)
+    {
+        if (m_others[index]->occludes(ray, origin, transmission))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}   // namespace RadRt
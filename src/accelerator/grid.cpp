@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "grid.h"
+#include "intersection.h"
+#include "ray.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+namespace RadRt
+{
+
+// Target number of cells per primitive when choosing the resolution.
+const float CELLS_PER_PRIMITIVE = 2.0;
+
+// Upper bound on the number of cells along each axis.
+const int MAX_RESOLUTION = 256;
+
+// Top-level cells holding more primitives than this are refined by a
+// nested grid.
+const unsigned int DENSE_CELL_SIZE = 16;
+
+// Extent given to flat axes so that every cell has a nonzero size.
+const float MIN_EXTENT = 1e-3;
+
+static inline float coordinate(const Point3d &p, int axis)
+{
+    return (axis == 0) ? p.x_coord() :
+           (axis == 1) ? p.y_coord() : p.z_coord();
+}
+
+static inline float component(const Vector3d &v, int axis)
+{
+    return (axis == 0) ? v.x_component() :
+           (axis == 1) ? v.y_component() : v.z_component();
+}
+
+namespace
+{
+
+/**
+ * Keeps the closest hit found during a walk, shortening the ray to it. The
+ * walk can stop as soon as the closest hit lies within the cell just
+ * visited, since every cell after it is farther away.
+ */
+struct ClosestHitVisitor
+{
+    ClosestHitVisitor(const Ray &ray, Intersection &hit):
+        ray(ray),
+        hit(hit),
+        found(false)
+    {
+    }
+
+    bool operator()(const GeometryStore &geometry, const unsigned int *,
+                    unsigned int begin, unsigned int end, float, float t_exit)
+    {
+        if (geometry.intersect(ray, begin, end, hit))
+        {
+            ray.set_t_max(hit.t());
+            found = true;
+        }
+        return found && (ray.t_max() <= t_exit);
+    }
+
+    Ray ray;
+    Intersection &hit;
+    bool found;
+};
+
+/**
+ * Looks for an opaque primitive before the end of the ray. Primitives that
+ * have attenuated the ray are remembered, so that those overlapping several
+ * cells attenuate it only once.
+ */
+struct OcclusionVisitor
+{
+    OcclusionVisitor(const Ray &ray, const Intersection *origin,
+                     float &transmission):
+        ray(ray),
+        origin(origin),
+        transmission(transmission),
+        attenuated_count(0)
+    {
+    }
+
+    bool operator()(const GeometryStore &geometry, const unsigned int *ids,
+                    unsigned int begin, unsigned int end, float, float)
+    {
+        for (unsigned int slot = begin; slot < end; ++slot)
+        {
+            unsigned int id = ids[slot];
+            if (was_attenuated(id))
+            {
+                continue;
+            }
+
+            float before = transmission;
+            if (geometry.occluded(ray, slot, slot + 1, origin, transmission))
+            {
+                return true;
+            }
+            if (transmission != before)
+            {
+                if (attenuated_count < INLINE_ATTENUATED)
+                {
+                    attenuated[attenuated_count++] = id;
+                }
+                else
+                {
+                    overflow.push_back(id);
+                }
+            }
+        }
+        return false;
+    }
+
+    bool was_attenuated(unsigned int id) const
+    {
+        for (int index = 0; index < attenuated_count; ++index)
+        {
+            if (attenuated[index] == id)
+            {
+                return true;
+            }
+        }
+        return !overflow.empty() &&
+               (std::find(overflow.begin(), overflow.end(), id) !=
+                overflow.end());
+    }
+
+    // Rays rarely pass through more than a few transparent shapes, so they
+    // are remembered without allocating until that is exceeded
+    static const int INLINE_ATTENUATED = 8;
+
+    const Ray &ray;
+    const Intersection *origin;
+    float &transmission;
+    unsigned int attenuated[INLINE_ATTENUATED];
+    int attenuated_count;
+    std::vector<unsigned int> overflow;
+};
+
+}   // namespace
+
+Grid::Grid()
+{
+    m_resolution[0] = m_resolution[1] = m_resolution[2] = 0;
+    m_cell_size[0] = m_cell_size[1] = m_cell_size[2] = 0;
+}
+
+Grid::~Grid()
+{
+    clear();
+}
+
+void Grid::clear()
+{
+    for (unsigned int index = 0; index < m_subgrids.size(); ++index)
+    {
+        delete m_subgrids[index];
+    }
+
+    m_subgrids.clear();
+    m_cell_offsets.clear();
+    m_geometry.clear();
+    m_slot_ids.clear();
+    m_bounds = BoundingBox();
+}
+
+void Grid::build(const std::vector<Shape*> &shapes)
+{
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+    clear();
+
+    if (shapes.empty())
+    {
+        return;
+    }
+
+    std::vector<Shape*> listed_shapes;
+    std::vector<unsigned int> listed_primitives;
+    GeometryStore::list_primitives(shapes, listed_shapes, listed_primitives);
+
+    std::vector<unsigned int> ids(listed_shapes.size());
+    for (unsigned int index = 0; index < ids.size(); ++index)
+    {
+        ids[index] = index;
+    }
+
+    BoundingBox bounds;
+    for (unsigned int index = 0; index < shapes.size(); ++index)
+    {
+        bounds.expand(shapes[index]->bounds());
+    }
+
+    build_cells(listed_shapes, listed_primitives, ids, bounds, 0);
+
+    unsigned int refined = 0;
+    for (unsigned int index = 0; index < m_subgrids.size(); ++index)
+    {
+        refined += (m_subgrids[index] != nullptr);
+    }
+
+    std::chrono::steady_clock::duration elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "grid: " << shapes.size() << " shapes, "
+              << listed_shapes.size() << " primitives, "
+              << m_resolution[0] << "x" << m_resolution[1] << "x"
+              << m_resolution[2] << " cells, " << refined << " refined, "
+              << "built in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     elapsed).count()
+              << " ms" << std::endl;
+}
+
+void Grid::build_cells(const std::vector<Shape*> &shapes,
+                       const std::vector<unsigned int> &primitives,
+                       const std::vector<unsigned int> &ids,
+                       const BoundingBox &bounds, int level)
+{
+    // Give flat axes some thickness so that no cell is degenerate
+    Point3d min = bounds.min();
+    Point3d max = bounds.max();
+    float extent[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        extent[axis] = std::max(bounds.max(axis) - bounds.min(axis),
+                                MIN_EXTENT);
+    }
+    Vector3d padding((extent[0] - (max.x_coord() - min.x_coord())) * 0.5f,
+                     (extent[1] - (max.y_coord() - min.y_coord())) * 0.5f,
+                     (extent[2] - (max.z_coord() - min.z_coord())) * 0.5f);
+    m_bounds = BoundingBox(Point3d(min, padding, -1),
+                           Point3d(max, padding, 1));
+
+    // Choose the resolution so that the grid holds roughly
+    // CELLS_PER_PRIMITIVE cells for every primitive, with cubic cells
+    float volume = extent[0] * extent[1] * extent[2];
+    float cells_per_unit = cbrt(CELLS_PER_PRIMITIVE * shapes.size() /
+                                volume);
+
+    int cell_count = 1;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_resolution[axis] = std::min(std::max(
+            int(extent[axis] * cells_per_unit), 1), MAX_RESOLUTION);
+        m_cell_size[axis] = extent[axis] / m_resolution[axis];
+        cell_count *= m_resolution[axis];
+    }
+
+    // Find the range of cells overlapped by each primitive
+    std::vector<int> ranges(6 * shapes.size());
+    for (unsigned int index = 0; index < shapes.size(); ++index)
+    {
+        BoundingBox box = shapes[index]->primitive_bounds(primitives[index]);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float lower = (box.min(axis) - m_bounds.min(axis)) /
+                          m_cell_size[axis];
+            float upper = (box.max(axis) - m_bounds.min(axis)) /
+                          m_cell_size[axis];
+            ranges[6 * index + axis] = std::min(std::max(int(lower), 0),
+                                                m_resolution[axis] - 1);
+            ranges[6 * index + 3 + axis] = std::min(std::max(int(upper), 0),
+                                                    m_resolution[axis] - 1);
+        }
+    }
+
+    // Count the primitives of each cell, then lay the cells out back to back
+    m_cell_offsets.assign(cell_count + 1, 0);
+    for (unsigned int index = 0; index < shapes.size(); ++index)
+    {
+        const int *range = &ranges[6 * index];
+        for (int z = range[2]; z <= range[5]; ++z)
+            for (int y = range[1]; y <= range[4]; ++y)
+                for (int x = range[0]; x <= range[3]; ++x)
+                    ++m_cell_offsets[cell_index(x, y, z) + 1];
+    }
+
+    for (int cell = 0; cell < cell_count; ++cell)
+    {
+        m_cell_offsets[cell + 1] += m_cell_offsets[cell];
+    }
+
+    unsigned int slot_count = m_cell_offsets[cell_count];
+    std::vector<Shape*> slot_shapes(slot_count);
+    std::vector<unsigned int> slot_primitives(slot_count);
+    m_slot_ids.resize(slot_count);
+    std::vector<unsigned int> fill(m_cell_offsets.begin(),
+                                   m_cell_offsets.end() - 1);
+    for (unsigned int index = 0; index < shapes.size(); ++index)
+    {
+        const int *range = &ranges[6 * index];
+        for (int z = range[2]; z <= range[5]; ++z)
+            for (int y = range[1]; y <= range[4]; ++y)
+                for (int x = range[0]; x <= range[3]; ++x)
+                {
+                    unsigned int slot = fill[cell_index(x, y, z)]++;
+                    slot_shapes[slot] = shapes[index];
+                    slot_primitives[slot] = primitives[index];
+                    m_slot_ids[slot] = ids[index];
+                }
+    }
+
+    m_geometry.compile(slot_shapes, slot_primitives);
+
+    m_subgrids.assign(cell_count, nullptr);
+    if (level > 0)
+    {
+        return;
+    }
+
+    // Refine the cells that are still crowded
+    for (int z = 0; z < m_resolution[2]; ++z)
+    {
+        for (int y = 0; y < m_resolution[1]; ++y)
+        {
+            for (int x = 0; x < m_resolution[0]; ++x)
+            {
+                int cell = cell_index(x, y, z);
+                unsigned int begin = m_cell_offsets[cell];
+                unsigned int end = m_cell_offsets[cell + 1];
+                if (end - begin <= DENSE_CELL_SIZE)
+                {
+                    continue;
+                }
+
+                Point3d cell_min(
+                    m_bounds.min(0) + x * m_cell_size[0],
+                    m_bounds.min(1) + y * m_cell_size[1],
+                    m_bounds.min(2) + z * m_cell_size[2]);
+                Point3d cell_max(
+                    cell_min.x_coord() + m_cell_size[0],
+                    cell_min.y_coord() + m_cell_size[1],
+                    cell_min.z_coord() + m_cell_size[2]);
+
+                std::vector<Shape*> cell_shapes(
+                    slot_shapes.begin() + begin, slot_shapes.begin() + end);
+                std::vector<unsigned int> cell_primitives(
+                    slot_primitives.begin() + begin,
+                    slot_primitives.begin() + end);
+                std::vector<unsigned int> cell_ids(
+                    m_slot_ids.begin() + begin, m_slot_ids.begin() + end);
+
+                m_subgrids[cell] = new Grid();
+                m_subgrids[cell]->build_cells(
+                    cell_shapes, cell_primitives, cell_ids,
+                    BoundingBox(cell_min, cell_max), level + 1);
+            }
+        }
+    }
+}
+
+template <typename Visitor>
+bool Grid::walk(const Ray &ray, float t_min, float t_max,
+                Visitor &visitor) const
+{
+    if (m_cell_offsets.empty())
+    {
+        return false;
+    }
+
+    float origin[3];
+    float direction[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        origin[axis] = coordinate(ray.vertex(), axis);
+        direction[axis] = component(ray.direction(), axis);
+    }
+
+    // Clip the ray to the grid
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float inverse_direction = 1.0f / direction[axis];
+        float t0 = (m_bounds.min(axis) - origin[axis]) * inverse_direction;
+        float t1 = (m_bounds.max(axis) - origin[axis]) * inverse_direction;
+
+        if (t0 > t1)
+        {
+            std::swap(t0, t1);
+        }
+
+        t_min = std::max(t_min, t0);
+        t_max = std::min(t_max, t1);
+
+        if (t_min > t_max)
+        {
+            return false;
+        }
+    }
+
+    // Set up the walk from the cell the ray enters
+    int cell[3];
+    int step[3];
+    int stop[3];
+    float t_next[3];
+    float t_delta[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float entry = origin[axis] + direction[axis] * t_min;
+        cell[axis] = std::min(std::max(
+            int((entry - m_bounds.min(axis)) / m_cell_size[axis]), 0),
+            m_resolution[axis] - 1);
+
+        if (direction[axis] > 0)
+        {
+            step[axis] = 1;
+            stop[axis] = m_resolution[axis];
+            t_next[axis] = (m_bounds.min(axis) +
+                            (cell[axis] + 1) * m_cell_size[axis] -
+                            origin[axis]) / direction[axis];
+            t_delta[axis] = m_cell_size[axis] / direction[axis];
+        }
+        else if (direction[axis] < 0)
+        {
+            step[axis] = -1;
+            stop[axis] = -1;
+            t_next[axis] = (m_bounds.min(axis) +
+                            cell[axis] * m_cell_size[axis] -
+                            origin[axis]) / direction[axis];
+            t_delta[axis] = -m_cell_size[axis] / direction[axis];
+        }
+        else
+        {
+            step[axis] = 0;
+            stop[axis] = -1;
+            t_next[axis] = std::numeric_limits<float>::max();
+            t_delta[axis] = 0;
+        }
+    }
+
+    float t_enter = t_min;
+
+    while (true)
+    {
+        int axis = (t_next[0] < t_next[1]) ?
+                       ((t_next[0] < t_next[2]) ? 0 : 2) :
+                       ((t_next[1] < t_next[2]) ? 1 : 2);
+        float t_exit = std::min(t_next[axis], t_max);
+
+        int index = cell_index(cell[0], cell[1], cell[2]);
+        bool done = false;
+
+        if (m_subgrids[index] != nullptr)
+        {
+            done = m_subgrids[index]->walk(ray, t_enter, t_exit, visitor);
+        }
+        else if (m_cell_offsets[index] != m_cell_offsets[index + 1])
+        {
+            done = visitor(m_geometry, &m_slot_ids[0], m_cell_offsets[index],
+                           m_cell_offsets[index + 1], t_enter, t_exit);
+        }
+
+        if (done)
+        {
+            return true;
+        }
+
+        if (t_next[axis] >= t_max)
+        {
+            return false;
+        }
+
+        cell[axis] += step[axis];
+        if (cell[axis] == stop[axis])
+        {
+            return false;
+        }
+
+        t_enter = t_exit;
+        t_next[axis] += t_delta[axis];
+    }
+}
+
+bool Grid::closest_intersection(const Ray &ray, Intersection &hit) const
+{
+    ClosestHitVisitor visitor(ray, hit);
+    walk(ray, ray.t_min(), ray.t_max(), visitor);
+    return visitor.found;
+}
+
+bool Grid::occluded(const Ray &ray, const Intersection *origin,
+                    float &transmission) const
+{
+    OcclusionVisitor visitor(ray, origin, transmission);
+    return walk(ray, ray.t_min(), ray.t_max(), visitor);
+}
+
+}   // namespace RadRt
@@ -0,0 +1,10 @@
+SOURCE += acceleratorfactory.cpp
+SOURCE += bvh.cpp
+SOURCE += cylinderbatch.cpp
+SOURCE += geometrystore.cpp
+SOURCE += grid.cpp
+SOURCE += qbvh.cpp
+SOURCE += rectanglebatch.cpp
+SOURCE += shapelist.cpp
+SOURCE += spherebatch.cpp
+SOURCE += trianglebatch.cpp
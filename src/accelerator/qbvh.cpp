@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "qbvh.h"
+#include "bvh.h"
+#include "intersection.h"
+#include "ray.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace RadRt
+{
+
+// Nodes are aligned to this many bytes, the size of a cache line.
+const size_t NODE_ALIGNMENT = 64;
+
+// Each level of the hierarchy leaves at most three children on the stack,
+// and it is never deeper than the binary hierarchy it was collapsed from.
+const int TRAVERSAL_STACK_SIZE = 512;
+
+static inline float coordinate(const Point3d &p, int axis)
+{
+    return (axis == 0) ? p.x_coord() :
+           (axis == 1) ? p.y_coord() : p.z_coord();
+}
+
+static inline float component(const Vector3d &v, int axis)
+{
+    return (axis == 0) ? v.x_component() :
+           (axis == 1) ? v.y_component() : v.z_component();
+}
+
+namespace
+{
+
+/**
+ * A child waiting to be visited, with the distance at which the ray
+ * enters it.
+ */
+struct StackEntry
+{
+    unsigned int child;
+    unsigned int count;
+    float t;
+};
+
+}   // namespace
+
+Qbvh::Qbvh():
+    m_nodes(nullptr),
+    m_node_count(0)
+{
+}
+
+Qbvh::~Qbvh()
+{
+    clear();
+}
+
+void Qbvh::clear()
+{
+    free(m_nodes);
+    m_nodes = nullptr;
+    m_node_count = 0;
+    m_geometry.clear();
+    m_bounds = BoundingBox();
+}
+
+void Qbvh::build(const std::vector<Shape*> &shapes)
+{
+    clear();
+
+    Bvh bvh;
+    bvh.build(shapes);
+    if (bvh.m_node_count == 0)
+    {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+    std::vector<Node> nodes;
+    nodes.reserve(bvh.m_node_count / 2 + 1);
+
+    if (bvh.m_node_data[0].count > 0)
+    {
+        // A single leaf still needs a node to hold it
+        Node root = Node();
+        const Bvh::Node &leaf = bvh.m_node_data[0];
+        for (int slot = 0; slot < WIDTH; ++slot)
+        {
+            bool used = (slot == 0);
+            float empty = std::numeric_limits<float>::infinity();
+            root.min_x[slot] = used ? leaf.min[0] : empty;
+            root.min_y[slot] = used ? leaf.min[1] : empty;
+            root.min_z[slot] = used ? leaf.min[2] : empty;
+            root.max_x[slot] = used ? leaf.max[0] : empty;
+            root.max_y[slot] = used ? leaf.max[1] : empty;
+            root.max_z[slot] = used ? leaf.max[2] : empty;
+            root.child[slot] = used ? leaf.offset : 0;
+            root.count[slot] = used ? leaf.count : 0;
+        }
+        nodes.push_back(root);
+    }
+    else
+    {
+        collapse(nodes, bvh, 0);
+    }
+
+    void *memory = nullptr;
+    if (posix_memalign(&memory, NODE_ALIGNMENT,
+                       nodes.size() * sizeof(Node)) != 0)
+    {
+        std::cerr << "qbvh: out of memory" << std::endl;
+        return;
+    }
+    m_nodes = static_cast<Node*>(memory);
+    std::memcpy(m_nodes, nodes.data(), nodes.size() * sizeof(Node));
+    m_node_count = nodes.size();
+
+    m_geometry = bvh.m_geometry;
+    m_bounds = bvh.bounds();
+
+    std::chrono::steady_clock::duration elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "qbvh: " << bvh.m_shapes.size() << " primitives, "
+              << m_node_count
+              << " nodes, collapsed in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     elapsed).count()
+              << " ms" << std::endl;
+}
+
+unsigned int Qbvh::collapse(std::vector<Node> &nodes, const Bvh &bvh,
+                            unsigned int binary_index)
+{
+    const Bvh::Node *binary = bvh.m_node_data;
+
+    // Open the largest interior child until there are four
+    unsigned int children[WIDTH] = { binary_index + 1,
+                                     binary[binary_index].offset };
+    int child_count = 2;
+
+    while (child_count < WIDTH)
+    {
+        int largest = -1;
+        float largest_area = -1;
+        for (int slot = 0; slot < child_count; ++slot)
+        {
+            const Bvh::Node &node = binary[children[slot]];
+            if (node.count > 0)
+            {
+                continue;
+            }
+
+            float dx = node.max[0] - node.min[0];
+            float dy = node.max[1] - node.min[1];
+            float dz = node.max[2] - node.min[2];
+            float area = dx * dy + dy * dz + dz * dx;
+            if (area > largest_area)
+            {
+                largest = slot;
+                largest_area = area;
+            }
+        }
+
+        if (largest < 0)
+        {
+            break;
+        }
+
+        unsigned int opened = children[largest];
+        children[largest] = opened + 1;
+        children[child_count++] = binary[opened].offset;
+    }
+
+    unsigned int node_index = nodes.size();
+    nodes.push_back(Node());
+
+    for (int slot = 0; slot < WIDTH; ++slot)
+    {
+        float min[3];
+        float max[3];
+        unsigned int child = 0;
+        unsigned short count = 0;
+
+        if (slot < child_count)
+        {
+            const Bvh::Node &node = binary[children[slot]];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                min[axis] = node.min[axis];
+                max[axis] = node.max[axis];
+            }
+
+            if (node.count > 0)
+            {
+                child = node.offset;
+                count = node.count;
+            }
+            else
+            {
+                child = collapse(nodes, bvh, children[slot]);
+            }
+        }
+        else
+        {
+            float empty = std::numeric_limits<float>::infinity();
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                min[axis] = max[axis] = empty;
+            }
+        }
+
+        // The vector may have grown while collapsing the child
+        Node &target = nodes[node_index];
+        target.min_x[slot] = min[0];
+        target.min_y[slot] = min[1];
+        target.min_z[slot] = min[2];
+        target.max_x[slot] = max[0];
+        target.max_y[slot] = max[1];
+        target.max_z[slot] = max[2];
+        target.child[slot] = child;
+        target.count[slot] = count;
+    }
+
+    return node_index;
+}
+
+inline int Qbvh::intersect_children(const Node &node,
+                                    const float origin[3],
+                                    const float inverse_direction[3],
+                                    float t_min, float t_max,
+                                    float t_near[WIDTH])
+{
+#ifdef __SSE__
+    __m128 origin_x = _mm_set1_ps(origin[0]);
+    __m128 origin_y = _mm_set1_ps(origin[1]);
+    __m128 origin_z = _mm_set1_ps(origin[2]);
+    __m128 inverse_x = _mm_set1_ps(inverse_direction[0]);
+    __m128 inverse_y = _mm_set1_ps(inverse_direction[1]);
+    __m128 inverse_z = _mm_set1_ps(inverse_direction[2]);
+
+    __m128 t0_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.min_x), origin_x),
+                             inverse_x);
+    __m128 t1_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.max_x), origin_x),
+                             inverse_x);
+    __m128 t0_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.min_y), origin_y),
+                             inverse_y);
+    __m128 t1_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.max_y), origin_y),
+                             inverse_y);
+    __m128 t0_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.min_z), origin_z),
+                             inverse_z);
+    __m128 t1_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.max_z), origin_z),
+                             inverse_z);
+
+    __m128 t_enter = _mm_max_ps(
+        _mm_max_ps(_mm_min_ps(t0_x, t1_x), _mm_min_ps(t0_y, t1_y)),
+        _mm_max_ps(_mm_min_ps(t0_z, t1_z), _mm_set1_ps(t_min)));
+    __m128 t_exit = _mm_min_ps(
+        _mm_min_ps(_mm_max_ps(t0_x, t1_x), _mm_max_ps(t0_y, t1_y)),
+        _mm_min_ps(_mm_max_ps(t0_z, t1_z), _mm_set1_ps(t_max)));
+
+    _mm_storeu_ps(t_near, t_enter);
+    return _mm_movemask_ps(_mm_cmple_ps(t_enter, t_exit));
+#else
+    const float *mins[3] = { node.min_x, node.min_y, node.min_z };
+    const float *maxs[3] = { node.max_x, node.max_y, node.max_z };
+
+    int mask = 0;
+    for (int slot = 0; slot < WIDTH; ++slot)
+    {
+        float t_enter = t_min;
+        float t_exit = t_max;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float t0 = (mins[axis][slot] - origin[axis]) *
+                       inverse_direction[axis];
+            float t1 = (maxs[axis][slot] - origin[axis]) *
+                       inverse_direction[axis];
+            t_enter = std::max(t_enter, std::min(t0, t1));
+            t_exit = std::min(t_exit, std::max(t0, t1));
+        }
+        t_near[slot] = t_enter;
+        if (t_enter <= t_exit)
+        {
+            mask |= 1 << slot;
+        }
+    }
+    return mask;
+#endif
+}
+
+bool Qbvh::closest_intersection(const Ray &ray, Intersection &hit) const
+{
+    if (m_node_count == 0)
+    {
+        return false;
+    }
+
+    Vector3d direction = ray.direction();
+
+    float origin[3];
+    float inverse_direction[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        origin[axis] = coordinate(ray.vertex(), axis);
+        inverse_direction[axis] = 1.0f / component(direction, axis);
+    }
+
+    // Each hit shortens the ray, so that children and shapes beyond it are
+    // culled
+    Ray bounded = ray;
+    bool found = false;
+
+    StackEntry stack[TRAVERSAL_STACK_SIZE];
+    int stack_size = 0;
+
+    // The root is entered as an interior child at distance zero
+    StackEntry entry = { 0, 0, 0 };
+    stack[stack_size++] = entry;
+
+    while (stack_size > 0)
+    {
+        entry = stack[--stack_size];
+        if (entry.t > bounded.t_max())
+        {
+            continue;
+        }
+
+        if (entry.count > 0)
+        {
+            if (m_geometry.intersect(bounded, entry.child,
+                                     entry.child + entry.count, hit))
+            {
+                bounded.set_t_max(hit.t());
+                found = true;
+            }
+            continue;
+        }
+
+        const Node &node = m_nodes[entry.child];
+
+        float t_near[WIDTH];
+        int mask = intersect_children(node, origin, inverse_direction,
+                                      bounded.t_min(), bounded.t_max(),
+                                      t_near);
+
+        // Push the children farthest first, so the nearest is popped next
+        int first = stack_size;
+        for (int slot = 0; slot < WIDTH; ++slot)
+        {
+            if ((mask & (1 << slot)) == 0)
+            {
+                continue;
+            }
+
+            StackEntry child = { node.child[slot], node.count[slot],
+                                 t_near[slot] };
+            int position = stack_size++;
+            while ((position > first) && (stack[position - 1].t < child.t))
+            {
+                stack[position] = stack[position - 1];
+                --position;
+            }
+            stack[position] = child;
+        }
+    }
+
+    return found;
+}
+
+bool Qbvh::occluded(const Ray &ray, const Intersection *from,
+                    float &transmission) const
+{
+    if (m_node_count == 0)
+    {
+        return false;
+    }
+
+    Vector3d direction = ray.direction();
+
+    float origin[3];
+    float inverse_direction[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        origin[axis] = coordinate(ray.vertex(), axis);
+        inverse_direction[axis] = 1.0f / component(direction, axis);
+    }
+
+    unsigned int stack[TRAVERSAL_STACK_SIZE];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0)
+    {
+        const Node &node = m_nodes[stack[--stack_size]];
+
+        float t_near[WIDTH];
+        int mask = intersect_children(node, origin, inverse_direction,
+                                      ray.t_min(), ray.t_max(), t_near);
+
+        // Any hit will do, so leaves are tested as soon as they are found
+        for (int slot = 0; slot < WIDTH; ++slot)
+        {
+            if ((mask & (1 << slot)) == 0)
+            {
+                continue;
+            }
+
+            if (node.count[slot] == 0)
+            {
+                stack[stack_size++] = node.child[slot];
+                continue;
+            }
+
+            if (m_geometry.occluded(ray, node.child[slot],
+                                    node.child[slot] + node.count[slot],
+                                    from, transmission))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+}   // namespace RadRt
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "rectanglebatch.h"
+#include "intersection.h"
+#include "ray.h"
+#include "rectangle.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace RadRt
+{
+
+void RectangleBatch::assign(const std::vector<Rectangle*> &rectangles)
+{
+    m_rectangles = rectangles;
+
+    // A zero normal makes every ray parallel to the plane, so that the
+    // padding is never hit
+    unsigned int size = rectangles.size() + PADDING;
+    m_normal_x.assign(size, 0);
+    m_normal_y.assign(size, 0);
+    m_normal_z.assign(size, 0);
+    m_plane_offset.assign(size, 0);
+    m_corner_x.assign(size, 0);
+    m_corner_y.assign(size, 0);
+    m_corner_z.assign(size, 0);
+    m_edge_u_x.assign(size, 0);
+    m_edge_u_y.assign(size, 0);
+    m_edge_u_z.assign(size, 0);
+    m_edge_v_x.assign(size, 0);
+    m_edge_v_y.assign(size, 0);
+    m_edge_v_z.assign(size, 0);
+
+    update();
+}
+
+void RectangleBatch::update()
+{
+    for (unsigned int index = 0; index < m_rectangles.size(); ++index)
+    {
+        const Rectangle *rectangle = m_rectangles[index];
+        m_normal_x[index] = rectangle->normal().x_component();
+        m_normal_y[index] = rectangle->normal().y_component();
+        m_normal_z[index] = rectangle->normal().z_component();
+        m_plane_offset[index] = rectangle->plane_offset();
+        m_corner_x[index] = rectangle->c().x_coord();
+        m_corner_y[index] = rectangle->c().y_coord();
+        m_corner_z[index] = rectangle->c().z_coord();
+        m_edge_u_x[index] = rectangle->edge_u().x_component();
+        m_edge_u_y[index] = rectangle->edge_u().y_component();
+        m_edge_u_z[index] = rectangle->edge_u().z_component();
+        m_edge_v_x[index] = rectangle->edge_v().x_component();
+        m_edge_v_y[index] = rectangle->edge_v().y_component();
+        m_edge_v_z[index] = rectangle->edge_v().z_component();
+    }
+}
+
+void RectangleBatch::clear()
+{
+    m_rectangles.clear();
+    m_normal_x.clear();
+    m_normal_y.clear();
+    m_normal_z.clear();
+    m_plane_offset.clear();
+    m_corner_x.clear();
+    m_corner_y.clear();
+    m_corner_z.clear();
+    m_edge_u_x.clear();
+    m_edge_u_y.clear();
+    m_edge_u_z.clear();
+    m_edge_v_x.clear();
+    m_edge_v_y.clear();
+    m_edge_v_z.clear();
+}
+
+inline int RectangleBatch::test(const Ray &ray, unsigned int index,
+                                unsigned int end, float t_max,
+                                float t[4]) const
+{
+    // The arithmetic follows Rectangle::intersect step by step, so that
+    // both find exactly the same distances
+    const Point3d &vertex = ray.vertex();
+    const Vector3d &direction = ray.direction();
+    float t_min = ray.t_min();
+
+#ifdef __SSE__
+    __m128 ox = _mm_set1_ps(vertex.x_coord());
+    __m128 oy = _mm_set1_ps(vertex.y_coord());
+    __m128 oz = _mm_set1_ps(vertex.z_coord());
+    __m128 dx = _mm_set1_ps(direction.x_component());
+    __m128 dy = _mm_set1_ps(direction.y_component());
+    __m128 dz = _mm_set1_ps(direction.z_component());
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+
+    __m128 nx = _mm_loadu_ps(&m_normal_x[index]);
+    __m128 ny = _mm_loadu_ps(&m_normal_y[index]);
+    __m128 nz = _mm_loadu_ps(&m_normal_z[index]);
+
+    __m128 denominator = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, nx),
+                                               _mm_mul_ps(dy, ny)),
+                                    _mm_mul_ps(dz, nz));
+    __m128 numerator = _mm_sub_ps(
+        _mm_loadu_ps(&m_plane_offset[index]),
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, nx), _mm_mul_ps(oy, ny)),
+                   _mm_mul_ps(oz, nz)));
+    __m128 distance = _mm_div_ps(numerator, denominator);
+
+    __m128 valid = _mm_and_ps(_mm_cmpneq_ps(denominator, zero),
+                              _mm_and_ps(_mm_cmpge_ps(distance,
+                                                      _mm_set1_ps(t_min)),
+                                         _mm_cmple_ps(distance,
+                                                      _mm_set1_ps(t_max))));
+    if (_mm_movemask_ps(valid) == 0)
+    {
+        return 0;
+    }
+
+    __m128 ix = _mm_sub_ps(_mm_add_ps(ox, _mm_mul_ps(dx, distance)),
+                           _mm_loadu_ps(&m_corner_x[index]));
+    __m128 iy = _mm_sub_ps(_mm_add_ps(oy, _mm_mul_ps(dy, distance)),
+                           _mm_loadu_ps(&m_corner_y[index]));
+    __m128 iz = _mm_sub_ps(_mm_add_ps(oz, _mm_mul_ps(dz, distance)),
+                           _mm_loadu_ps(&m_corner_z[index]));
+
+    __m128 u = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(ix, _mm_loadu_ps(&m_edge_u_x[index])),
+                   _mm_mul_ps(iy, _mm_loadu_ps(&m_edge_u_y[index]))),
+        _mm_mul_ps(iz, _mm_loadu_ps(&m_edge_u_z[index])));
+    __m128 v = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(ix, _mm_loadu_ps(&m_edge_v_x[index])),
+                   _mm_mul_ps(iy, _mm_loadu_ps(&m_edge_v_y[index]))),
+        _mm_mul_ps(iz, _mm_loadu_ps(&m_edge_v_z[index])));
+
+    valid = _mm_and_ps(valid,
+                       _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(u, zero),
+                                             _mm_cmplt_ps(u, one)),
+                                  _mm_and_ps(_mm_cmpge_ps(v, zero),
+                                             _mm_cmplt_ps(v, one))));
+
+    int mask = _mm_movemask_ps(valid);
+    _mm_storeu_ps(t, distance);
+#else
+    float origin_x = vertex.x_coord();
+    float origin_y = vertex.y_coord();
+    float origin_z = vertex.z_coord();
+    float direction_x = direction.x_component();
+    float direction_y = direction.y_component();
+    float direction_z = direction.z_component();
+
+    int mask = 0;
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        unsigned int slot = index + lane;
+        float nx = m_normal_x[slot];
+        float ny = m_normal_y[slot];
+        float nz = m_normal_z[slot];
+
+        float denominator = direction_x * nx + direction_y * ny +
+                            direction_z * nz;
+        if (denominator == 0)
+        {
+            continue;
+        }
+
+        float distance = (m_plane_offset[slot] -
+                          (origin_x * nx + origin_y * ny + origin_z * nz)) /
+                         denominator;
+        if ((distance < t_min) || (distance > t_max))
+        {
+            continue;
+        }
+
+        float ix = (origin_x + direction_x * distance) - m_corner_x[slot];
+        float iy = (origin_y + direction_y * distance) - m_corner_y[slot];
+        float iz = (origin_z + direction_z * distance) - m_corner_z[slot];
+
+        float u = ix * m_edge_u_x[slot] + iy * m_edge_u_y[slot] +
+                  iz * m_edge_u_z[slot];
+        float v = ix * m_edge_v_x[slot] + iy * m_edge_v_y[slot] +
+                  iz * m_edge_v_z[slot];
+
+        if ((u >= 0) && (u < 1) && (v >= 0) && (v < 1))
+        {
+            t[lane] = distance;
+            mask |= 1 << lane;
+        }
+    }
+#endif
+
+    if (end - index < 4)
+    {
+        mask &= (1 << (end - index)) - 1;
+    }
+    return mask;
+}
+
+bool RectangleBatch::intersect(const Ray &ray, unsigned int begin,
+                               unsigned int end, Intersection &hit) const
+{
+    float t_max = ray.t_max();
+    int closest = -1;
+
+    for (unsigned int index = begin; index < end; index += 4)
+    {
+        float t[4];
+        int mask = test(ray, index, end, t_max, t);
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            if ((mask & 1) && (t[lane] <= t_max))
+            {
+                t_max = t[lane];
+                closest = index + lane;
+            }
+        }
+    }
+
+    if (closest < 0)
+    {
+        return false;
+    }
+
+    m_rectangles[closest]->intersection_at(ray, t_max, hit);
+    return true;
+}
+
+bool RectangleBatch::occluded(const Ray &ray, unsigned int begin,
+                              unsigned int end, const Shape *origin,
+                              float &transmission) const
+{
+    for (unsigned int index = begin; index < end; index += 4)
+    {
+        float t[4];
+        int mask = test(ray, index, end, ray.t_max(), t);
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            const Rectangle *rectangle = m_rectangles[index + lane];
+            if (!(mask & 1) || (rectangle == origin))
+            {
+                continue;
+            }
+
+            if (rectangle->transmissive_constant() <= 0)
+            {
+                return true;
+            }
+            transmission *= rectangle->transmissive_constant();
+        }
+    }
+
+    return false;
+}
+
+}   // namespace RadRt
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "shapelist.h"
+#include "intersection.h"
+#include "ray.h"
+
+#include <limits>
+
+namespace RadRt
+{
+
+void ShapeList::build(const std::vector<Shape*> &shapes)
+{
+    GeometryStore::list_primitives(shapes, m_shapes, m_primitives);
+    m_geometry.compile(m_shapes, m_primitives);
+    m_bounds = BoundingBox();
+
+    for (unsigned int index = 0; index < shapes.size(); ++index)
+    {
+        m_bounds.expand(shapes[index]->bounds());
+    }
+}
+
+bool ShapeList::closest_intersection(const Ray &ray,
+                                     Intersection &hit) const
+{
+    return m_geometry.intersect(ray, 0, m_shapes.size(), hit);
+}
+
+bool ShapeList::occluded(const Ray &ray, const Intersection *origin,
+                         float &transmission) const
+{
+    return m_geometry.occluded(ray, 0, m_shapes.size(), origin,
+                               transmission);
+}
+
+}   // namespace RadRt
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "spherebatch.h"
+#include "intersection.h"
+#include "ray.h"
+#include "sphere.h"
+
+#include <cmath>
+#include <limits>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace RadRt
+{
+
+void SphereBatch::assign(const std::vector<Sphere*> &spheres)
+{
+    m_spheres = spheres;
+
+    // An infinitely negative squared radius makes the discriminant negative
+    // for every ray, so that the padding is never hit
+    unsigned int size = spheres.size() + PADDING;
+    m_center_x.assign(size, 0);
+    m_center_y.assign(size, 0);
+    m_center_z.assign(size, 0);
+    m_radius_squared.assign(size, -std::numeric_limits<float>::infinity());
+
+    update();
+}
+
+void SphereBatch::update()
+{
+    for (unsigned int index = 0; index < m_spheres.size(); ++index)
+    {
+        const Sphere *sphere = m_spheres[index];
+        m_center_x[index] = sphere->center().x_coord();
+        m_center_y[index] = sphere->center().y_coord();
+        m_center_z[index] = sphere->center().z_coord();
+        m_radius_squared[index] = sphere->radius() * sphere->radius();
+    }
+}
+
+void SphereBatch::clear()
+{
+    m_spheres.clear();
+    m_center_x.clear();
+    m_center_y.clear();
+    m_center_z.clear();
+    m_radius_squared.clear();
+}
+
+inline int SphereBatch::test(const Ray &ray, unsigned int index,
+                             unsigned int end, float t_max,
+                             float t[4]) const
+{
+    // The arithmetic follows Sphere::intersect step by step, so that both
+    // find exactly the same distances
+    const Point3d &vertex = ray.vertex();
+    const Vector3d &direction = ray.direction();
+    float a = dot_product(direction, direction);
+    float t_min = ray.t_min();
+
+#ifdef __SSE__
+    __m128 dx = _mm_set1_ps(direction.x_component());
+    __m128 dy = _mm_set1_ps(direction.y_component());
+    __m128 dz = _mm_set1_ps(direction.z_component());
+    __m128 a4 = _mm_set1_ps(a);
+
+    __m128 ocx = _mm_sub_ps(_mm_set1_ps(vertex.x_coord()),
+                            _mm_loadu_ps(&m_center_x[index]));
+    __m128 ocy = _mm_sub_ps(_mm_set1_ps(vertex.y_coord()),
+                            _mm_loadu_ps(&m_center_y[index]));
+    __m128 ocz = _mm_sub_ps(_mm_set1_ps(vertex.z_coord()),
+                            _mm_loadu_ps(&m_center_z[index]));
+
+    __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx),
+                                     _mm_mul_ps(ocy, dy)),
+                          _mm_mul_ps(ocz, dz));
+    __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx),
+                                                _mm_mul_ps(ocy, ocy)),
+                                     _mm_mul_ps(ocz, ocz)),
+                          _mm_loadu_ps(&m_radius_squared[index]));
+    __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a4, c));
+
+    __m128 root = _mm_sqrt_ps(discriminant);
+    __m128 minus_b = _mm_sub_ps(_mm_setzero_ps(), b);
+    __m128 t_far = _mm_div_ps(_mm_add_ps(minus_b, root), a4);
+    __m128 t_near = _mm_div_ps(_mm_sub_ps(minus_b, root), a4);
+
+    // A negative discriminant gives no roots, and comparisons with them
+    // fail
+    __m128 t_min4 = _mm_set1_ps(t_min);
+    __m128 t_max4 = _mm_set1_ps(t_max);
+    __m128 near_valid = _mm_and_ps(_mm_cmpge_ps(t_near, t_min4),
+                                   _mm_cmple_ps(t_near, t_max4));
+    __m128 far_valid = _mm_and_ps(_mm_cmpge_ps(t_far, t_min4),
+                                  _mm_cmple_ps(t_far, t_max4));
+
+    int mask = _mm_movemask_ps(_mm_or_ps(near_valid, far_valid));
+    _mm_storeu_ps(t, _mm_or_ps(_mm_and_ps(near_valid, t_near),
+                               _mm_andnot_ps(near_valid, t_far)));
+#else
+    int mask = 0;
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        float ocx = vertex.x_coord() - m_center_x[index + lane];
+        float ocy = vertex.y_coord() - m_center_y[index + lane];
+        float ocz = vertex.z_coord() - m_center_z[index + lane];
+
+        float b = ocx * direction.x_component() +
+                  ocy * direction.y_component() +
+                  ocz * direction.z_component();
+        float c = (ocx * ocx + ocy * ocy + ocz * ocz) -
+                  m_radius_squared[index + lane];
+        float discriminant = b * b - a * c;
+        if (discriminant < 0)
+        {
+            continue;
+        }
+
+        float root = std::sqrt(discriminant);
+        float t_near = (-b - root) / a;
+        float t_far = (-b + root) / a;
+
+        if ((t_near >= t_min) && (t_near <= t_max))
+        {
+            t[lane] = t_near;
+            mask |= 1 << lane;
+        }
+        else if ((t_far >= t_min) && (t_far <= t_max))
+        {
+            t[lane] = t_far;
+            mask |= 1 << lane;
+        }
+    }
+#endif
+
+    if (end - index < 4)
+    {
+        mask &= (1 << (end - index)) - 1;
+    }
+    return mask;
+}
+
+bool SphereBatch::intersect(const Ray &ray, unsigned int begin,
+                            unsigned int end, Intersection &hit) const
+{
+    float t_max = ray.t_max();
+    int closest = -1;
+
+    for (unsigned int index = begin; index < end; index += 4)
+    {
+        float t[4];
+        int mask = test(ray, index, end, t_max, t);
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            if ((mask & 1) && (t[lane] <= t_max))
+            {
+                t_max = t[lane];
+                closest = index + lane;
+            }
+        }
+    }
+
+    if (closest < 0)
+    {
+        return false;
+    }
+
+    m_spheres[closest]->intersection_at(ray, t_max, hit);
+    return true;
+}
+
+bool SphereBatch::occluded(const Ray &ray, unsigned int begin,
+                           unsigned int end, const Shape *origin,
+                           float &transmission) const
+{
+    for (unsigned int index = begin; index < end; index += 4)
+    {
+        float t[4];
+        int mask = test(ray, index, end, ray.t_max(), t);
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            const Sphere *sphere = m_spheres[index + lane];
+            if (!(mask & 1) || (sphere == origin))
+            {
+                continue;
+            }
+
+            if (sphere->transmissive_constant() <= 0)
+            {
+                return true;
+            }
+            transmission *= sphere->transmissive_constant();
+        }
+    }
+
+    return false;
+}
+
+}   // namespace RadRt
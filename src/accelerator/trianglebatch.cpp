@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "trianglebatch.h"
+#include "intersection.h"
+#include "mesh.h"
+#include "ray.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace RadRt
+{
+
+void TriangleBatch::assign(const std::vector<Mesh*> &meshes,
+                           const std::vector<unsigned int> &triangles)
+{
+    m_meshes = meshes;
+    m_triangles = triangles;
+
+    // Zero edges make the determinant zero for every ray, so that the
+    // padding is never hit
+    unsigned int size = meshes.size() + PADDING;
+    m_corner_x.assign(size, 0);
+    m_corner_y.assign(size, 0);
+    m_corner_z.assign(size, 0);
+    m_edge1_x.assign(size, 0);
+    m_edge1_y.assign(size, 0);
+    m_edge1_z.assign(size, 0);
+    m_edge2_x.assign(size, 0);
+    m_edge2_y.assign(size, 0);
+    m_edge2_z.assign(size, 0);
+
+    update();
+}
+
+void TriangleBatch::update()
+{
+    for (unsigned int index = 0; index < m_meshes.size(); ++index)
+    {
+        Point3d corner;
+        Vector3d edge1;
+        Vector3d edge2;
+        m_meshes[index]->triangle(m_triangles[index], corner, edge1, edge2);
+
+        m_corner_x[index] = corner.x_coord();
+        m_corner_y[index] = corner.y_coord();
+        m_corner_z[index] = corner.z_coord();
+        m_edge1_x[index] = edge1.x_component();
+        m_edge1_y[index] = edge1.y_component();
+        m_edge1_z[index] = edge1.z_component();
+        m_edge2_x[index] = edge2.x_component();
+        m_edge2_y[index] = edge2.y_component();
+        m_edge2_z[index] = edge2.z_component();
+    }
+}
+
+void TriangleBatch::clear()
+{
+    m_meshes.clear();
+    m_triangles.clear();
+    m_corner_x.clear();
+    m_corner_y.clear();
+    m_corner_z.clear();
+    m_edge1_x.clear();
+    m_edge1_y.clear();
+    m_edge1_z.clear();
+    m_edge2_x.clear();
+    m_edge2_y.clear();
+    m_edge2_z.clear();
+}
+
+inline int TriangleBatch::test(const Ray &ray, unsigned int index,
+                               unsigned int end, float t_max,
+                               float t[4]) const
+{
+    // The arithmetic follows Mesh::intersect_triangle step by step, so that
+    // both find exactly the same distances
+    const Point3d &vertex = ray.vertex();
+    const Vector3d &direction = ray.direction();
+    float t_min = ray.t_min();
+
+#ifdef __SSE__
+    __m128 dx = _mm_set1_ps(direction.x_component());
+    __m128 dy = _mm_set1_ps(direction.y_component());
+    __m128 dz = _mm_set1_ps(direction.z_component());
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+
+    __m128 e1x = _mm_loadu_ps(&m_edge1_x[index]);
+    __m128 e1y = _mm_loadu_ps(&m_edge1_y[index]);
+    __m128 e1z = _mm_loadu_ps(&m_edge1_z[index]);
+    __m128 e2x = _mm_loadu_ps(&m_edge2_x[index]);
+    __m128 e2y = _mm_loadu_ps(&m_edge2_y[index]);
+    __m128 e2z = _mm_loadu_ps(&m_edge2_z[index]);
+
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px),
+                                               _mm_mul_ps(e1y, py)),
+                                    _mm_mul_ps(e1z, pz));
+    __m128 inverse = _mm_div_ps(one, determinant);
+
+    __m128 sx = _mm_sub_ps(_mm_set1_ps(vertex.x_coord()),
+                           _mm_loadu_ps(&m_corner_x[index]));
+    __m128 sy = _mm_sub_ps(_mm_set1_ps(vertex.y_coord()),
+                           _mm_loadu_ps(&m_corner_y[index]));
+    __m128 sz = _mm_sub_ps(_mm_set1_ps(vertex.z_coord()),
+                           _mm_loadu_ps(&m_corner_z[index]));
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px),
+                                                _mm_mul_ps(sy, py)),
+                                     _mm_mul_ps(sz, pz)),
+                          inverse);
+
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx),
+                                                _mm_mul_ps(dy, qy)),
+                                     _mm_mul_ps(dz, qz)),
+                          inverse);
+    __m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx),
+                                                       _mm_mul_ps(e2y, qy)),
+                                            _mm_mul_ps(e2z, qz)),
+                                 inverse);
+
+    __m128 valid = _mm_and_ps(_mm_cmpneq_ps(determinant, zero),
+                              _mm_and_ps(_mm_cmpge_ps(u, zero),
+                                         _mm_cmple_ps(u, one)));
+    valid = _mm_and_ps(valid,
+                       _mm_and_ps(_mm_cmpge_ps(v, zero),
+                                  _mm_cmple_ps(_mm_add_ps(u, v), one)));
+    valid = _mm_and_ps(valid,
+                       _mm_and_ps(_mm_cmpge_ps(distance, _mm_set1_ps(t_min)),
+                                  _mm_cmple_ps(distance,
+                                               _mm_set1_ps(t_max))));
+
+    int mask = _mm_movemask_ps(valid);
+    _mm_storeu_ps(t, distance);
+#else
+    float dx = direction.x_component();
+    float dy = direction.y_component();
+    float dz = direction.z_component();
+
+    int mask = 0;
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        unsigned int slot = index + lane;
+        float e1x = m_edge1_x[slot];
+        float e1y = m_edge1_y[slot];
+        float e1z = m_edge1_z[slot];
+        float e2x = m_edge2_x[slot];
+        float e2y = m_edge2_y[slot];
+        float e2z = m_edge2_z[slot];
+
+        float px = dy * e2z - dz * e2y;
+        float py = dz * e2x - dx * e2z;
+        float pz = dx * e2y - dy * e2x;
+        float determinant = e1x * px + e1y * py + e1z * pz;
+        if (determinant == 0)
+        {
+            continue;
+        }
+        float inverse = 1.0f / determinant;
+
+        float sx = vertex.x_coord() - m_corner_x[slot];
+        float sy = vertex.y_coord() - m_corner_y[slot];
+        float sz = vertex.z_coord() - m_corner_z[slot];
+        float u = (sx * px + sy * py + sz * pz) * inverse;
+
+        float qx = sy * e1z - sz * e1y;
+        float qy = sz * e1x - sx * e1z;
+        float qz = sx * e1y - sy * e1x;
+        float v = (dx * qx + dy * qy + dz * qz) * inverse;
+        float distance = (e2x * qx + e2y * qy + e2z * qz) * inverse;
+
+        if ((u >= 0) && (u <= 1) && (v >= 0) && (u + v <= 1) &&
+            (distance >= t_min) && (distance <= t_max))
+        {
+            t[lane] = distance;
+            mask |= 1 << lane;
+        }
+    }
+#endif
+
+    if (end - index < 4)
+    {
+        mask &= (1 << (end - index)) - 1;
+    }
+    return mask;
+}
+
+bool TriangleBatch::intersect(const Ray &ray, unsigned int begin,
+                              unsigned int end, Intersection &hit) const
+{
+    float t_max = ray.t_max();
+    int closest = -1;
+
+    for (unsigned int index = begin; index < end; index += 4)
+    {
+        float t[4];
+        int mask = test(ray, index, end, t_max, t);
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            if ((mask & 1) && (t[lane] <= t_max))
+            {
+                t_max = t[lane];
+                closest = index + lane;
+            }
+        }
+    }
+
+    if (closest < 0)
+    {
+        return false;
+    }
+
+    m_meshes[closest]->intersection_at(ray, t_max, m_triangles[closest],
+                                       hit);
+    return true;
+}
+
+bool TriangleBatch::occluded(const Ray &ray, unsigned int begin,
+                             unsigned int end, float &transmission) const
+{
+    for (unsigned int index = begin; index < end; index += 4)
+    {
+        float t[4];
+        int mask = test(ray, index, end, ray.t_max(), t);
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            if (!(mask & 1))
+            {
+                continue;
+            }
+
+            const Mesh *mesh = m_meshes[index + lane];
+            if (mesh->transmissive_constant() <= 0)
+            {
+                return true;
+            }
+            transmission *= mesh->transmissive_constant();
+        }
+    }
+
+    return false;
+}
+
+}   // namespace RadRt
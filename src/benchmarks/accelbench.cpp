@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+/*
+ * Compares the four-wide hierarchy with the binary one it is collapsed
+ * from. Random rays start inside the bounds of each scene and head in random
+ * directions; both hierarchies trace them for the closest hit, then for
+ * occlusion over a quarter of the diagonal of the bounds. The shapes hit
+ * and the rays blocked must be the same for both, and any ray where they
+ * differ is counted as a mismatch.
+ *
+ * Usage: accelbench [scene.json ...]
+ * Without scene files, synthetic sphere scenes are traced, along with
+ * scenes/whitted.json when run from the top of the tree.
+ */
+
+#include "benchmark.h"
+#include "bvh.h"
+#include "intersection.h"
+#include "qbvh.h"
+#include "ray.h"
+#include "scene.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace RadRt
+{
+
+const unsigned int RAY_COUNT = 200000;
+const unsigned int SYNTHETIC_SPHERE_COUNTS[] = {50000, 100000, 1000000};
+const char *const SHIPPED_SCENE = "scenes/whitted.json";
+
+static std::vector<Ray> random_rays(const BoundingBox &bounds,
+                                    float distance)
+{
+    const Point3d &low = bounds.min();
+    const Point3d &high = bounds.max();
+
+    SceneRandom random(RAY_COUNT);
+    std::vector<Ray> rays;
+    rays.reserve(RAY_COUNT);
+    while (rays.size() < RAY_COUNT)
+    {
+        Point3d origin(
+            low.x_coord() + (high.x_coord() - low.x_coord()) * random.next(),
+            low.y_coord() + (high.y_coord() - low.y_coord()) * random.next(),
+            low.z_coord() + (high.z_coord() - low.z_coord()) * random.next());
+        Vector3d direction(random.next() - 0.5f, random.next() - 0.5f,
+                           random.next() - 0.5f);
+
+        // Rejected rather than normalized into a skewed direction
+        if (length(direction) < 1e-2f)
+        {
+            continue;
+        }
+        rays.push_back(Ray(origin, normalize(direction), 0, distance));
+    }
+    return rays;
+}
+
+/**
+ * Trace every ray for its closest hit, recording the shape hit by each.
+ */
+static double closest_ms(const Accelerator &accelerator,
+                         const std::vector<Ray> &rays,
+                         std::vector<const Shape*> &shapes_hit)
+{
+    shapes_hit.assign(rays.size(), nullptr);
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (unsigned int index = 0; index < rays.size(); ++index)
+    {
+        Intersection hit;
+        if (accelerator.closest_intersection(rays[index], hit))
+        {
+            shapes_hit[index] = hit.intersected_shape();
+        }
+    }
+    return milliseconds_since(start);
+}
+
+/**
+ * Trace every ray for occlusion, recording whether each is blocked.
+ */
+static double occluded_ms(const Accelerator &accelerator,
+                          const std::vector<Ray> &rays,
+                          std::vector<bool> &blocked)
+{
+    blocked.assign(rays.size(), false);
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (unsigned int index = 0; index < rays.size(); ++index)
+    {
+        float transmission = 1;
+        blocked[index] = accelerator.occluded(rays[index], nullptr,
+                                              transmission);
+    }
+    return milliseconds_since(start);
+}
+
+static void benchmark_shapes(const std::string &name,
+                             const std::vector<Shape*> &shapes,
+                             QuietOutput &output)
+{
+    Bvh bvh;
+    bvh.build(shapes);
+    Qbvh qbvh;
+    qbvh.build(shapes);
+
+    const BoundingBox &bounds = bvh.bounds();
+    Vector3d diagonal = bounds.max() - bounds.min();
+    std::vector<Ray> rays = random_rays(bounds, 0.25f * length(diagonal));
+
+    std::vector<const Shape*> bvh_hits;
+    std::vector<const Shape*> qbvh_hits;
+    double bvh_closest = closest_ms(bvh, rays, bvh_hits);
+    double qbvh_closest = closest_ms(qbvh, rays, qbvh_hits);
+
+    std::vector<bool> bvh_blocked;
+    std::vector<bool> qbvh_blocked;
+    double bvh_occluded = occluded_ms(bvh, rays, bvh_blocked);
+    double qbvh_occluded = occluded_ms(qbvh, rays, qbvh_blocked);
+
+    unsigned int mismatches = 0;
+    for (unsigned int index = 0; index < rays.size(); ++index)
+    {
+        if ((bvh_hits[index] != qbvh_hits[index]) ||
+            (bvh_blocked[index] != qbvh_blocked[index]))
+        {
+            ++mismatches;
+        }
+    }
+
+    char line[160];
+    std::snprintf(line, sizeof(line),
+                  "%-24s %8u %9.1f %9.1f %9.1f %9.1f %10u\n",
+                  name.c_str(), (unsigned int)shapes.size(), bvh_closest,
+                  qbvh_closest, bvh_occluded, qbvh_occluded, mismatches);
+    output.report() << line << std::flush;
+}
+
+static bool benchmark_file(const std::string &file, QuietOutput &output)
+{
+    Json::Value root;
+    if (!read_scene_json(file, root))
+    {
+        return false;
+    }
+
+    // The scene's own accelerator is not used, so a list costs the least
+    root["accelerator"] = "list";
+
+    Scene scene;
+    scene.set_scene_file(file);
+    scene.deserialize(root);
+
+    benchmark_shapes(file, *scene.shapes(), output);
+    return true;
+}
+
+}   // namespace RadRt
+
+int main(int argc, char **argv)
+{
+    using namespace RadRt;
+
+    QuietOutput output;
+    output.report() << "                                    closest ms"
+                       "          occluded ms\n"
+                       "scene                      shapes       bvh      qbvh"
+                       "       bvh      qbvh  mismatches\n";
+
+    if (argc > 1)
+    {
+        for (int arg = 1; arg < argc; ++arg)
+        {
+            if (!benchmark_file(argv[arg], output))
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    for (unsigned int index = 0;
+         index < sizeof(SYNTHETIC_SPHERE_COUNTS) /
+                 sizeof(SYNTHETIC_SPHERE_COUNTS[0]); ++index)
+    {
+        unsigned int count = SYNTHETIC_SPHERE_COUNTS[index];
+        std::vector<Shape*> shapes = sphere_scene_shapes(count);
+        benchmark_shapes(std::to_string(count) + " spheres", shapes, output);
+
+        for (unsigned int shape = 0; shape < shapes.size(); ++shape)
+        {
+            delete shapes[shape];
+        }
+    }
+    benchmark_file(SHIPPED_SCENE, output);
+    return 0;
+}
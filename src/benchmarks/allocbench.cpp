@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+/*
+ * Counts the heap allocations made while rendering, to keep track of
+ * tracing a ray allocating nothing. Each scene is rendered on one thread
+ * with single rays, with packets and in wavefronts, and the allocations of
+ * the whole render are divided by its primary rays. What remains is the
+ * setup of the image and its tiles, which does not grow with the rays
+ * traced through a tile.
+ *
+ * Usage: allocbench [scene.json ...]
+ * Without scene files, synthetic sphere scenes are rendered.
+ */
+
+#include "benchmark.h"
+#include "image.h"
+#include "raytracer.h"
+#include "scene.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Every allocation made by the program, counted by the replaced operator
+// new; the array forms call it too.
+static std::atomic<unsigned long> allocation_count(0);
+
+void *operator new(std::size_t size)
+{
+    ++allocation_count;
+    void *memory = std::malloc((size == 0) ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+namespace RadRt
+{
+
+const int TILE_SIZE = 32;
+const int MAX_DEPTH = 3;
+const unsigned int SYNTHETIC_SPHERE_COUNTS[] = {1000, 50000};
+
+struct Mode
+{
+    const char *name;
+    int packet_size;
+    bool wavefront;
+};
+
+const Mode MODES[] = {
+    {"single", 1, false},
+    {"packets", 8, false},
+    {"wavefront", 8, true},
+};
+
+static void benchmark_scene(const std::string &name, const std::string &file,
+                            const Json::Value &root, QuietOutput &output)
+{
+    Scene scene;
+    scene.set_scene_file(file);
+    scene.deserialize(root);
+    SceneSnapshot snapshot(scene);
+
+    long rays = long(scene.width()) * scene.height();
+    long tiles = long((scene.width() + TILE_SIZE - 1) / TILE_SIZE) *
+                 ((scene.height() + TILE_SIZE - 1) / TILE_SIZE);
+
+    for (unsigned int mode = 0; mode < sizeof(MODES) / sizeof(MODES[0]);
+         ++mode)
+    {
+        Raytracer raytracer;
+        raytracer.set_max_depth(MAX_DEPTH);
+        raytracer.set_thread_count(1);
+        raytracer.set_tile_size(TILE_SIZE);
+        raytracer.set_packet_size(MODES[mode].packet_size);
+        raytracer.set_wavefront(MODES[mode].wavefront);
+
+        unsigned long before = allocation_count;
+        Image *image = raytracer.trace_scene(snapshot);
+        unsigned long allocations = allocation_count - before;
+        delete image;
+
+        char line[160];
+        std::snprintf(line, sizeof(line),
+                      "%-24s %-10s %9ld %6ld %12lu %10.4f %10.2f\n",
+                      name.c_str(), MODES[mode].name, rays, tiles,
+                      allocations, double(allocations) / rays,
+                      double(allocations) / tiles);
+        output.report() << line << std::flush;
+    }
+}
+
+}   // namespace RadRt
+
+int main(int argc, char **argv)
+{
+    using namespace RadRt;
+
+    // Synthetic scenes have no file
+    std::vector<std::string> names;
+    std::vector<std::string> files;
+    std::vector<Json::Value> scenes;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        Json::Value root;
+        if (!read_scene_json(argv[arg], root))
+        {
+            return 1;
+        }
+        names.push_back(argv[arg]);
+        files.push_back(argv[arg]);
+        scenes.push_back(root);
+    }
+    if (scenes.empty())
+    {
+        for (unsigned int index = 0;
+             index < sizeof(SYNTHETIC_SPHERE_COUNTS) /
+                     sizeof(SYNTHETIC_SPHERE_COUNTS[0]); ++index)
+        {
+            unsigned int count = SYNTHETIC_SPHERE_COUNTS[index];
+            names.push_back(std::to_string(count) + " spheres");
+            files.push_back("");
+            scenes.push_back(sphere_scene_json(count, "bvh"));
+        }
+    }
+
+    QuietOutput output;
+    output.report() << "scene                    mode        primary"
+                       "  tiles  allocations  per ray   per tile\n";
+    for (unsigned int index = 0; index < scenes.size(); ++index)
+    {
+        benchmark_scene(names[index], files[index], scenes[index], output);
+    }
+    return 0;
+}
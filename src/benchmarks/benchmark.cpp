@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "benchmark.h"
+#include "sphere.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace RadRt
+{
+
+static Json::Value json_triple(const char *x_name, float x,
+                               const char *y_name, float y,
+                               const char *z_name, float z)
+{
+    Json::Value root;
+    root[x_name] = x;
+    root[y_name] = y;
+    root[z_name] = z;
+    return root;
+}
+
+static Json::Value json_point(float x, float y, float z)
+{
+    return json_triple("x", x, "y", y, "z", z);
+}
+
+static Json::Value json_color(float red, float green, float blue)
+{
+    return json_triple("r", red, "g", green, "b", blue);
+}
+
+/**
+ * Scene side for a number of spheres, about one sphere for every 8 units of
+ * volume.
+ */
+static float sphere_scene_side(unsigned int sphere_count)
+{
+    return 2 * std::cbrt(float(sphere_count));
+}
+
+/**
+ * Make the next sphere of a synthetic scene.
+ */
+static Json::Value sphere_json(SceneRandom &random, float side,
+                               unsigned int index)
+{
+    Json::Value sphere;
+    sphere["type"] = "sphere";
+    sphere["center"] = json_point((random.next() - 0.5f) * side,
+                                  (random.next() - 0.5f) * side,
+                                  (random.next() - 0.5f) * side);
+    sphere["radius"] = 0.2f + 0.6f * random.next();
+
+    Json::Value color = json_color(random.next(), random.next(),
+                                   random.next());
+    sphere["ambient_color"] = color;
+    sphere["diffuse_color"] = color;
+    sphere["specular_color"] = json_color(1, 1, 1);
+    sphere["ambient_constant"] = 0.2;
+    sphere["diffuse_constant"] = 0.6;
+    sphere["specular_constant"] = 0.4;
+    sphere["specular_exponent"] = 20;
+
+    // One in eight spheres reflects, so that some secondary rays are
+    // traced too
+    sphere["reflective_value"] = (index % 8 == 0) ? 0.5 : 0.0;
+    sphere["transmissive_value"] = 0.0;
+    sphere["refraction_index"] = 1.0;
+    return sphere;
+}
+
+bool read_scene_json(const std::string &filename, Json::Value &root)
+{
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!in)
+    {
+        std::cerr << "Cannot open " << filename << std::endl;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << in.rdbuf();
+
+    Json::Reader reader;
+    if (!reader.parse(contents.str(), root))
+    {
+        std::cerr << "Failed to parse " << filename << "\n"
+                  << reader.getFormattedErrorMessages();
+        return false;
+    }
+    return true;
+}
+
+Json::Value sphere_scene_json(unsigned int sphere_count,
+                              const std::string &accelerator,
+                              int width, int height)
+{
+    float side = sphere_scene_side(sphere_count);
+
+    Json::Value root;
+    root["accelerator"] = accelerator;
+    root["dimensions"]["width"] = width;
+    root["dimensions"]["height"] = height;
+    root["background_color"] = json_color(0, 0.65, 0.9);
+
+    Json::Value &camera = root["camera"];
+    camera["location"] = json_point(0, 0, side);
+    camera["view_vector"] = json_point(0, 0, -1);
+    camera["up_vector"] = json_point(0, 1, 0);
+    camera["focal_length"] = 6;
+    camera["horizontal_spread"] = 45;
+
+    Json::Value light;
+    light["position"] = json_point(side, side, side);
+    light["color"] = json_color(1, 1, 1);
+    root["lights"].append(light);
+
+    SceneRandom random(sphere_count);
+    Json::Value &shapes = root["shapes"];
+    for (unsigned int index = 0; index < sphere_count; ++index)
+    {
+        shapes.append(sphere_json(random, side, index));
+    }
+
+    return root;
+}
+
+std::vector<Shape*> sphere_scene_shapes(unsigned int sphere_count)
+{
+    float side = sphere_scene_side(sphere_count);
+
+    std::vector<Shape*> shapes;
+    shapes.reserve(sphere_count);
+
+    SceneRandom random(sphere_count);
+    for (unsigned int index = 0; index < sphere_count; ++index)
+    {
+        Sphere *sphere = new Sphere();
+        sphere->deserialize(sphere_json(random, side, index));
+        shapes.push_back(sphere);
+    }
+    return shapes;
+}
+
+QuietOutput::QuietOutput():
+    m_buffer(std::cout.rdbuf()),
+    m_report(m_buffer)
+{
+    std::cout.rdbuf(nullptr);
+}
+
+QuietOutput::~QuietOutput()
+{
+    std::cout.rdbuf(m_buffer);
+}
+
+}   // namespace RadRt
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+/*
+ * Times building a bounding volume hierarchy over synthetic sphere scenes,
+ * for a range of sphere counts and of threads to build on. Each build is
+ * repeated and the fastest kept, and the speedup is against building on
+ * one thread, which builds serially.
+ *
+ * Usage: buildbench [sphere_count ...]
+ * Without sphere counts, scenes of 1000 up to a million spheres are built.
+ */
+
+#include "benchmark.h"
+#include "bvh.h"
+#include "shape.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace RadRt
+{
+
+const int REPEAT_COUNT = 3;
+const unsigned int DEFAULT_SPHERE_COUNTS[] = {1000, 10000, 100000, 1000000};
+
+static std::vector<unsigned int> thread_counts()
+{
+    std::vector<unsigned int> counts;
+    counts.push_back(1);
+    counts.push_back(2);
+    counts.push_back(4);
+
+    unsigned int hardware = ThreadPool::hardware_threads();
+    if (std::find(counts.begin(), counts.end(), hardware) == counts.end())
+    {
+        counts.push_back(hardware);
+    }
+    return counts;
+}
+
+static double best_build_ms(const std::vector<Shape*> &shapes,
+                            ThreadPool &pool)
+{
+    double best = 0;
+    for (int repeat = 0; repeat < REPEAT_COUNT; ++repeat)
+    {
+        Bvh bvh;
+        bvh.set_thread_pool(&pool);
+
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        bvh.build(shapes);
+        double elapsed = milliseconds_since(start);
+
+        if ((repeat == 0) || (elapsed < best))
+        {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+}   // namespace RadRt
+
+int main(int argc, char **argv)
+{
+    using namespace RadRt;
+
+    std::vector<unsigned int> sphere_counts;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        int count = std::atoi(argv[arg]);
+        if (count <= 0)
+        {
+            std::cerr << "Invalid sphere count: " << argv[arg] << std::endl;
+            return 1;
+        }
+        sphere_counts.push_back(count);
+    }
+    if (sphere_counts.empty())
+    {
+        sphere_counts.assign(DEFAULT_SPHERE_COUNTS,
+                             DEFAULT_SPHERE_COUNTS +
+                             sizeof(DEFAULT_SPHERE_COUNTS) /
+                             sizeof(DEFAULT_SPHERE_COUNTS[0]));
+    }
+
+    std::vector<unsigned int> threads = thread_counts();
+
+    QuietOutput output;
+    output.report() << "spheres    threads   build ms   speedup\n";
+    for (unsigned int index = 0; index < sphere_counts.size(); ++index)
+    {
+        std::vector<Shape*> shapes = sphere_scene_shapes(sphere_counts[index]);
+
+        double serial_ms = 0;
+        for (unsigned int thread = 0; thread < threads.size(); ++thread)
+        {
+            ThreadPool pool(threads[thread]);
+            double build_ms = best_build_ms(shapes, pool);
+            if (thread == 0)
+            {
+                serial_ms = build_ms;
+            }
+
+            char line[80];
+            std::snprintf(line, sizeof(line), "%-10u %7u %10.2f %9.2f\n",
+                          sphere_counts[index], threads[thread], build_ms,
+                          serial_ms / build_ms);
+            output.report() << line << std::flush;
+        }
+
+        for (unsigned int shape = 0; shape < shapes.size(); ++shape)
+        {
+            delete shapes[shape];
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,5 @@
+BENCHMARK_SOURCE += benchmark.cpp
+BENCHMARKS += accelbench.cpp
+BENCHMARKS += allocbench.cpp
+BENCHMARKS += buildbench.cpp
+BENCHMARKS += traversalbench.cpp
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+/*
+ * Measures primary rays per second in each order tiles, packets and rays
+ * are traced in, with single rays and with full packets, on one thread.
+ * The renders of the orders are interleaved, and the fastest of each kept,
+ * so that a machine slowing down or speeding up does not favor one order.
+ *
+ * Usage: traversalbench [--order name ...] [scene.json ...]
+ * Orders are "scanline", "morton" and "hilbert", all three by default.
+ * Without scene files, a synthetic scene of 50000 spheres is rendered.
+ */
+
+#include "benchmark.h"
+#include "image.h"
+#include "raytracer.h"
+#include "scene.h"
+#include "traversalorder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace RadRt
+{
+
+const int REPEAT_COUNT = 3;
+const int MAX_DEPTH = 3;
+const int PACKET_SIZES[] = {1, 8};
+const char *const ORDER_NAMES[] = {"scanline", "morton", "hilbert"};
+const unsigned int SYNTHETIC_SPHERE_COUNT = 50000;
+
+static void benchmark_scene(const std::string &name, const std::string &file,
+                            const Json::Value &root,
+                            const std::vector<std::string> &order_names,
+                            const std::vector<TraversalOrder> &orders,
+                            QuietOutput &output)
+{
+    Scene scene;
+    scene.set_scene_file(file);
+    scene.deserialize(root);
+    SceneSnapshot snapshot(scene);
+
+    double rays = double(scene.width()) * scene.height();
+
+    for (unsigned int packet = 0;
+         packet < sizeof(PACKET_SIZES) / sizeof(PACKET_SIZES[0]); ++packet)
+    {
+        int packet_size = PACKET_SIZES[packet];
+        std::vector<double> best_ms(orders.size(), 0);
+
+        for (int repeat = 0; repeat < REPEAT_COUNT; ++repeat)
+        {
+            for (unsigned int order = 0; order < orders.size(); ++order)
+            {
+                Raytracer raytracer;
+                raytracer.set_max_depth(MAX_DEPTH);
+                raytracer.set_thread_count(1);
+                raytracer.set_packet_size(packet_size);
+                raytracer.set_traversal_order(orders[order]);
+
+                std::chrono::steady_clock::time_point start =
+                    std::chrono::steady_clock::now();
+                Image *image = raytracer.trace_scene(snapshot);
+                double elapsed = milliseconds_since(start);
+                delete image;
+
+                if ((repeat == 0) || (elapsed < best_ms[order]))
+                {
+                    best_ms[order] = elapsed;
+                }
+            }
+        }
+
+        for (unsigned int order = 0; order < orders.size(); ++order)
+        {
+            char line[160];
+            std::snprintf(line, sizeof(line),
+                          "%-24s %dx%-5d %-10s %10.0f %12.0f\n",
+                          name.c_str(), packet_size, packet_size,
+                          order_names[order].c_str(), best_ms[order],
+                          rays / best_ms[order] * 1000);
+            output.report() << line << std::flush;
+        }
+    }
+}
+
+}   // namespace RadRt
+
+int main(int argc, char **argv)
+{
+    using namespace RadRt;
+
+    std::vector<std::string> order_names;
+    std::vector<std::string> files;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (std::strcmp(argv[arg], "--order") == 0)
+        {
+            if (arg + 1 == argc)
+            {
+                std::cerr << "--order needs a traversal order" << std::endl;
+                return 1;
+            }
+            order_names.push_back(argv[++arg]);
+        }
+        else
+        {
+            files.push_back(argv[arg]);
+        }
+    }
+    if (order_names.empty())
+    {
+        order_names.assign(ORDER_NAMES, ORDER_NAMES +
+                           sizeof(ORDER_NAMES) / sizeof(ORDER_NAMES[0]));
+    }
+
+    std::vector<TraversalOrder> orders(order_names.size());
+    for (unsigned int index = 0; index < order_names.size(); ++index)
+    {
+        if (!traversal_order_from_name(order_names[index], orders[index]))
+        {
+            std::cerr << "Unknown traversal order: " << order_names[index]
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Json::Value> scenes;
+    for (unsigned int index = 0; index < files.size(); ++index)
+    {
+        Json::Value root;
+        if (!read_scene_json(files[index], root))
+        {
+            return 1;
+        }
+        scenes.push_back(root);
+    }
+
+    QuietOutput output;
+    output.report() << "scene                    packet  order      "
+                       "render ms        rays/s\n";
+    if (scenes.empty())
+    {
+        benchmark_scene(std::to_string(SYNTHETIC_SPHERE_COUNT) + " spheres",
+                        "", sphere_scene_json(SYNTHETIC_SPHERE_COUNT, "bvh",
+                                              1280, 960),
+                        order_names, orders, output);
+    }
+    for (unsigned int index = 0; index < scenes.size(); ++index)
+    {
+        benchmark_scene(files[index], files[index], scenes[index],
+                        order_names, orders, output);
+    }
+    return 0;
+}
@@ -4,6 +4,7 @@
  */
 
 #include "light.h"
+#include "serialization.h"
 
 namespace RadRt
 {
@@ -17,15 +18,15 @@ Light::Light(Point3d position, Color color):
 Json::Value Light::serialize() const
 {
     Json::Value root;
-    root["position"] = m_position.serialize();
-    root["color"] = m_color.serialize();
+    root["position"] = to_json(m_position);
+    root["color"] = to_json(m_color);
     return root;
 }
 
 void Light::deserialize(const Json::Value &root)
 {
-    m_position.deserialize(root["position"]);
-    m_color.deserialize(root["color"]);
+    from_json(root["position"], m_position);
+    from_json(root["color"], m_color);
 }
 
 }   // namespace RadRt
@@ -1,4 +1,3 @@
 SOURCE += color.cpp
 SOURCE += light.cpp
-SOURCE += point3d.cpp
-SOURCE += vector3d.cpp
+SOURCE += serialization.cpp
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "serialization.h"
+
+namespace RadRt
+{
+
+Json::Value to_json(const Vector3d &vector)
+{
+    Json::Value root;
+    root["x"] = vector.x_component();
+    root["y"] = vector.y_component();
+    root["z"] = vector.z_component();
+    return root;
+}
+
+Json::Value to_json(const Point3d &point)
+{
+    Json::Value root;
+    root["x"] = point.x_coord();
+    root["y"] = point.y_coord();
+    root["z"] = point.z_coord();
+    return root;
+}
+
+Json::Value to_json(const Color &color)
+{
+    Json::Value root;
+    root["r"] = color.red();
+    root["g"] = color.green();
+    root["b"] = color.blue();
+    return root;
+}
+
+void from_json(const Json::Value &root, Vector3d &vector)
+{
+    vector = Vector3d(root["x"].asFloat(),
+                      root["y"].asFloat(),
+                      root["z"].asFloat());
+}
+
+void from_json(const Json::Value &root, Point3d &point)
+{
+    point = Point3d(root["x"].asFloat(),
+                    root["y"].asFloat(),
+                    root["z"].asFloat());
+}
+
+void from_json(const Json::Value &root, Color &color)
+{
+    color = Color(root["r"].asFloat(),
+                  root["g"].asFloat(),
+                  root["b"].asFloat());
+}
+
+}   // namespace RadRt
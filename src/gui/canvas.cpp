@@ -7,6 +7,7 @@
 #include "color.h"
 #include "image.h"
 
+#include <algorithm>
 #include <gdkmm/general.h>
 
 namespace RadRt
@@ -74,6 +75,46 @@ void Canvas::clear()
     queue_draw();
 }
 
+void Canvas::start_image(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    m_canvas = Gdk::Pixbuf::create(Gdk::COLORSPACE_RGB, HAS_ALPHA,
+                                   BITS_PER_SAMPLE, m_width, m_height);
+    m_canvas->fill(0x000000FF);
+
+    queue_draw();
+}
+
+void Canvas::draw_tile(const Image &tile, int left, int top, int scale)
+{
+    // Rows of the image count up from the bottom, rows of the canvas down
+    // from the top
+    for (int row = 0; row < tile.height(); ++row)
+    {
+        int first_row = top + row * scale;
+        int end_row = std::min(first_row + scale, m_height);
+
+        for (int column = 0; column < tile.width(); ++column)
+        {
+            int first_column = left + column * scale;
+            int end_column = std::min(first_column + scale, m_width);
+
+            const Color &color = *tile.get_pixel(row, column);
+            for (int image_row = first_row; image_row < end_row; ++image_row)
+            {
+                for (int image_column = first_column;
+                     image_column < end_column; ++image_column)
+                {
+                    set_pixel(m_height - image_row - 1, image_column, color);
+                }
+            }
+        }
+    }
+
+    queue_draw();
+}
 
 void Canvas::set_pixel(int row, int column, const Color &color)
 {
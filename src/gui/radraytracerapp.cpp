@@ -16,6 +16,12 @@
 #define LMAX    1000
 #define LDMAX   100
 
+// Scale of each pass of a render, relative to the full resolution. The
+// coarse pass traces a sixty-fourth of the rays, so a whole image is on
+// screen almost at once, and the full pass then replaces it tile by tile.
+static const int PASS_SCALES[] = {8, 1};
+static const int PASS_COUNT = sizeof(PASS_SCALES) / sizeof(PASS_SCALES[0]);
+
 int lmax = 0;
 int algo = 0;
 int depth = 3;
@@ -26,17 +32,41 @@ int lflag = 0;      /* specify lmax value for tone reproduction */
 namespace RadRt
 {
 
+/**
+ * Copy part of an image into an image of its own.
+ */
+static Image *copy_pixels(const Image &image, int left, int top, int right,
+                          int bottom)
+{
+    Image *pixels = new Image(right - left, bottom - top);
+    for (int row = top; row < bottom; ++row)
+    {
+        for (int column = left; column < right; ++column)
+        {
+            pixels->set_pixel(row - top, column - left,
+                              *image.get_pixel(row, column));
+        }
+    }
+    return pixels;
+}
+
 RadRaytracerApp::RadRaytracerApp():
     box(Gtk::ORIENTATION_VERTICAL),
-    image(nullptr),
-    scene(nullptr)
+    scene(nullptr),
+    render_handle(nullptr),
+    render_cancelled(false),
+    image(nullptr)
 {
     canvas = new Canvas();
+    tiles_dispatcher.connect(sigc::mem_fun(*this,
+              &RadRaytracerApp::on_tiles_rendered));
     init();
 }
 
 RadRaytracerApp::~RadRaytracerApp()
 {
+    wait_for_render();
+
     if (canvas != nullptr)
         delete canvas;
 
@@ -104,6 +134,9 @@ void RadRaytracerApp::init()
 
 void RadRaytracerApp::on_clear_clicked()
 {
+    // Tiles still to come were placed for the image the render started,
+    // not for the cleared canvas, so the render is cancelled first
+    wait_for_render();
     canvas->clear();
 }
 
@@ -117,8 +150,77 @@ void RadRaytracerApp::render_scene()
     if (scene == nullptr)
         return;
 
-    run_raytracer();
-    canvas->draw_image(image);
+    wait_for_render();
+
+    {
+        std::unique_lock<std::mutex> lock(render_mutex);
+        delete image;
+        image = nullptr;
+    }
+
+    canvas->start_image(scene->width(), scene->height());
+
+    // The snapshot is taken here, so that the render thread never reads
+    // the scene itself
+    render_thread = std::thread(&RadRaytracerApp::run_raytracer, this,
+                                SceneSnapshot(*scene));
+}
+
+void RadRaytracerApp::wait_for_render()
+{
+    if (render_thread.joinable())
+    {
+        {
+            std::unique_lock<std::mutex> lock(render_mutex);
+            render_cancelled = true;
+            if (render_handle != nullptr)
+            {
+                render_handle->cancel();
+            }
+        }
+        render_thread.join();
+        render_cancelled = false;
+    }
+
+    std::unique_lock<std::mutex> lock(tiles_mutex);
+    for (unsigned int index = 0; index < rendered_tiles.size(); ++index)
+    {
+        delete rendered_tiles[index].pixels;
+    }
+    rendered_tiles.clear();
+}
+
+void RadRaytracerApp::post_tile(Image *pixels, int left, int top, int scale)
+{
+    RenderedTile tile;
+    tile.pixels = pixels;
+    tile.left = left;
+    tile.top = top;
+    tile.scale = scale;
+
+    {
+        std::unique_lock<std::mutex> lock(tiles_mutex);
+        rendered_tiles.push_back(tile);
+    }
+    tiles_dispatcher.emit();
+}
+
+void RadRaytracerApp::on_tiles_rendered()
+{
+    // Several tiles may have finished since the last wakeup, and the
+    // tiles of a dropped render leave wakeups with nothing to draw
+    std::vector<RenderedTile> tiles;
+    {
+        std::unique_lock<std::mutex> lock(tiles_mutex);
+        tiles.swap(rendered_tiles);
+    }
+
+    for (unsigned int index = 0; index < tiles.size(); ++index)
+    {
+        canvas->draw_tile(*tiles[index].pixels, tiles[index].left,
+                          tiles[index].top, tiles[index].scale);
+        delete tiles[index].pixels;
+    }
 }
 
 void RadRaytracerApp::save_scene(const char *filename)
@@ -187,21 +289,73 @@ void RadRaytracerApp::open_scene(const char *filename)
         return;
     }
 
+    // The render of the old scene shares its shapes, so it is cancelled
+    // before they are freed
+    wait_for_render();
+
     if (scene != nullptr)
     {
         delete scene;
     }
     scene = new Scene();
+    scene->set_scene_file(filename);
+    scene->set_accelerator_cache(std::string(filename) + ".accel");
     scene->deserialize(root);
 }
 
-void RadRaytracerApp::run_raytracer()
+void RadRaytracerApp::run_raytracer(const SceneSnapshot &snapshot)
 {
-    // Create the raytracer
-    RadRt::Raytracer raytracer;
     raytracer.set_max_depth(depth);
 
-    image = raytracer.trace_scene(scene);
+    Image *traced = nullptr;
+
+    for (int pass = 0; pass < PASS_COUNT; ++pass)
+    {
+        // Rounded up, so that the pass covers the whole image
+        int scale = PASS_SCALES[pass];
+        SceneSnapshot pass_snapshot(snapshot,
+                                    (snapshot.width() + scale - 1) / scale,
+                                    (snapshot.height() + scale - 1) / scale);
+
+        RenderHandle *handle = raytracer.trace_scene_async(pass_snapshot,
+            [this, scale](const Image &traced, int left, int top, int right,
+                          int bottom)
+            {
+                post_tile(copy_pixels(traced, left, top, right, bottom),
+                          left * scale, top * scale, scale);
+            });
+
+        {
+            std::unique_lock<std::mutex> lock(render_mutex);
+            render_handle = handle;
+            if (render_cancelled)
+            {
+                handle->cancel();
+            }
+        }
+
+        Image *pass_image = handle->take_image();
+
+        {
+            std::unique_lock<std::mutex> lock(render_mutex);
+            render_handle = nullptr;
+        }
+        delete handle;
+
+        if (pass_image == nullptr)
+        {
+            return;
+        }
+
+        if (scale == 1)
+        {
+            traced = pass_image;
+        }
+        else
+        {
+            delete pass_image;
+        }
+    }
 
     if (aflag && lflag)
     {
@@ -209,13 +363,21 @@ void RadRaytracerApp::run_raytracer()
         RadRt::ToneReproducer tr;
         if (algo == 1)
         {
-        	tr.apply_wards_algorithm(image, lmax, LDMAX);
+        	tr.apply_wards_algorithm(traced, lmax, LDMAX);
         }
         else
         {
-        	tr.apply_reinhards_algorithm(image, lmax);
+        	tr.apply_reinhards_algorithm(traced, lmax);
         }
+
+        // The tiles were drawn as traced, so draw the image again
+        post_tile(copy_pixels(*traced, 0, 0, traced->width(),
+                              traced->height()),
+                  0, 0, 1);
     }
+
+    std::unique_lock<std::mutex> lock(render_mutex);
+    image = traced;
 }
 
 }   // namespace RadRt
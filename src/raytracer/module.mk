@@ -1,2 +1,4 @@
 SOURCE += radraytracer.cpp
 SOURCE += raytracer.cpp
+SOURCE += renderhandle.cpp
+SOURCE += traversalorder.cpp
@@ -4,98 +4,347 @@
  */
 
 #include "raytracer.h"
+#include "accelerator.h"
 #include "ray.h"
 #include "intersection.h"
 #include "image.h"
+#include "raypacket.h"
+#include "renderhandle.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace RadRt
 {
 
 const int DEFAULT_MAX_DEPTH = 1;
 const int INITIAL_DEPTH = 0;
+const int DEFAULT_PACKET_SIZE = 8;
+const int MAX_PACKET_SIZE = 8;
+const int MAX_SECONDARY_RAYS = 2;
+const int DEFAULT_TILE_SIZE = 32;
+const TraversalOrder DEFAULT_TRAVERSAL_ORDER = HILBERT_ORDER;
+
+// Bits per axis of the origin in a wavefront sort key
+const int SORT_ORIGIN_BITS = 10;
+
+/**
+ * Map a value in a range to one of 2^bits cells, clamping values outside it.
+ */
+static unsigned int quantize(float value, float low, float high, int bits)
+{
+    float cells = float(1u << bits);
+    if (!(high > low))
+    {
+        return 0;
+    }
+    float cell = (value - low) / (high - low) * cells;
+    return (unsigned int) std::min(std::max(cell, 0.0f), cells - 1);
+}
+
+/**
+ * Key ordering rays by the octant of their direction, then by origin along
+ * a Morton curve through a box. Ordering by direction within the octant
+ * scatters the origins, which costs more than it saves.
+ */
+static uint64_t sort_key(const Ray &ray, const BoundingBox &bounds)
+{
+    Vector3d direction = ray.direction();
+    Point3d origin = ray.vertex();
+    float components[3] = {direction.x_component(), direction.y_component(),
+                           direction.z_component()};
+    float coordinates[3] = {origin.x_coord(), origin.y_coord(),
+                            origin.z_coord()};
+
+    uint64_t octant = 0;
+    unsigned int cells[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        octant = (octant << 1) | (components[axis] < 0);
+        cells[axis] = quantize(coordinates[axis], bounds.min(axis),
+                               bounds.max(axis), SORT_ORIGIN_BITS);
+    }
+
+    uint64_t morton = 0;
+    for (int bit = SORT_ORIGIN_BITS - 1; bit >= 0; --bit)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            morton = (morton << 1) | ((cells[axis] >> bit) & 1);
+        }
+    }
+
+    return (octant << (3 * SORT_ORIGIN_BITS)) | morton;
+}
+
+/**
+ * Log how fast primary rays were traced, to compare settings by.
+ */
+static void print_ray_rate(unsigned int rays, double seconds)
+{
+    std::cout << "primary rays: " << rays << " in "
+              << int(1000 * seconds + 0.5) << " ms, "
+              << int(rays / std::max(seconds, 1e-9) + 0.5) << " per second"
+              << std::endl;
+}
 
 Raytracer::Raytracer():
     m_max_depth(DEFAULT_MAX_DEPTH),
-    m_intersection(nullptr)
+    m_packet_size(DEFAULT_PACKET_SIZE),
+    m_wavefront(false),
+    m_tile_size(DEFAULT_TILE_SIZE),
+    m_thread_count(0),
+    m_traversal_order(DEFAULT_TRAVERSAL_ORDER),
+    m_pool(nullptr),
+    m_pool_users(0),
+    m_pool_stale(false)
 {
 }
 
+Raytracer::~Raytracer()
+{
+    delete m_pool;
+}
+
+void Raytracer::set_packet_size(int packet_size)
+{
+    m_packet_size = std::max(1, std::min(packet_size, MAX_PACKET_SIZE));
+}
+
+void Raytracer::set_tile_size(int tile_size)
+{
+    m_tile_size = std::max(1, tile_size);
+}
+
+void Raytracer::set_thread_count(unsigned int thread_count)
+{
+    std::unique_lock<std::mutex> lock(m_pool_mutex);
+    if (thread_count == m_thread_count)
+    {
+        return;
+    }
+    m_thread_count = thread_count;
+
+    // Renders still running hold on to the pool, so it is only replaced
+    // once the last of them lets go of it
+    if (m_pool_users == 0)
+    {
+        delete m_pool;
+        m_pool = nullptr;
+    }
+    else
+    {
+        m_pool_stale = true;
+    }
+}
+
 Ray Raytracer::make_reflection_ray(const Vector3d &normal,
                                  const Ray &ray,
-                                 const Point3d &intersection)
+                                 const Point3d &intersection) const
 {
     Ray reflection(intersection,
-                   normalize(
-                       vector_subtract(ray.direction(),
-                           scalar_multiply(normal,
-                               2 * dot_product(ray.direction(), normal)))));
+                   normalize(ray.direction() -
+                             normal * (2 * dot_product(ray.direction(),
+                                                       normal))),
+                   SURFACE_OFFSET);
      return reflection;
 }
 
-Intersection *Raytracer::get_closest_intersection(Scene *scene, const Ray &ray)
+bool Raytracer::get_closest_intersection(const SceneSnapshot &scene,
+                                         const Ray &ray,
+                                         Intersection &intersection) const
 {
-    ShapeVector *shapes = scene->shapes();
-    ShapeIterator iter = shapes->begin();
-    Intersection *closest_intersection = nullptr;
+    return scene.accelerator()->closest_intersection(ray, intersection);
+}
 
-    for (; iter != shapes->end(); ++iter)
+Color Raytracer::trace(const SceneSnapshot &scene, const Ray &ray,
+                       int depth) const
+{
+    if (depth >= m_max_depth)
     {
-        // Calculate the intersection with this shape
-        Ray *intersection = (*iter)->intersect(ray);
+        return scene.background();
+    }
+
+    Intersection intersection;
 
-        if (intersection != nullptr)
+    // If this ray hits nothing, return the background color
+    if (!get_closest_intersection(scene, ray, intersection))
+    {
+        return scene.background();
+    }
+
+    return shade(scene, ray, intersection, depth);
+}
+
+void Raytracer::trace(const SceneSnapshot &scene, const RayPacket &packet,
+                      Color colors[]) const
+{
+    if (INITIAL_DEPTH >= m_max_depth)
+    {
+        for (int index = 0; index < packet.size(); ++index)
         {
-            // Check if this intersection is closer
-            if ((closest_intersection == nullptr) ||
-                (distance_between(ray.vertex(),
-                                 intersection->vertex()) <
-                 distance_between(ray.vertex(),
-                                 closest_intersection->intersection_point())))
-            {
-                // Latest intersection is closer
-                if (closest_intersection != nullptr)
-                    delete closest_intersection;
-
-                closest_intersection = new Intersection(
-                                            intersection->vertex(),
-                                            intersection->direction(),
-                                            *iter);
-            }
-            delete intersection;
-            intersection = nullptr;
+            colors[index] = scene.background();
         }
+        return;
     }
 
-    return closest_intersection;
+    Intersection hits[RayPacket::MAX_SIZE];
+    bool found[RayPacket::MAX_SIZE];
+    scene.accelerator()->closest_intersections(packet, hits, found);
+
+    for (int index = 0; index < packet.size(); ++index)
+    {
+        if (found[index])
+        {
+            colors[index] = shade(scene, packet.ray(index), hits[index],
+                                  INITIAL_DEPTH);
+        }
+        else
+        {
+            colors[index] = scene.background();
+        }
+    }
 }
 
-Color Raytracer::trace(Scene *scene, Ray ray, int depth)
+void Raytracer::trace(const SceneSnapshot &scene, const RayPacket &packet,
+                      const int pixels[],
+                      std::vector<Wavefront> &wavefronts) const
 {
-    if (depth >= m_max_depth)
+    Intersection hits[RayPacket::MAX_SIZE];
+    bool found[RayPacket::MAX_SIZE];
+    scene.accelerator()->closest_intersections(packet, hits, found);
+
+    Wavefront &primary = wavefronts[INITIAL_DEPTH];
+    for (int index = 0; index < packet.size(); ++index)
+    {
+        int ray_index = primary.rays.size();
+        primary.add(packet.ray(index), pixels[index], 1);
+
+        if (found[index])
+        {
+            primary.colors[ray_index] =
+                shade(scene, packet.ray(index), hits[index], ray_index,
+                      wavefronts[INITIAL_DEPTH + 1]);
+        }
+        else
+        {
+            primary.colors[ray_index] = scene.background();
+        }
+    }
+}
+
+void Raytracer::trace_wavefronts(const SceneSnapshot &scene,
+                                 std::vector<Wavefront> &wavefronts) const
+{
+    const Accelerator *accelerator = scene.accelerator();
+    BoundingBox bounds = accelerator->bounds();
+    std::vector<std::pair<uint64_t, int> > order;
+
+    for (int depth = INITIAL_DEPTH + 1; depth < m_max_depth; ++depth)
     {
-        return scene->background();
+        Wavefront &wavefront = wavefronts[depth];
+
+        // Rays heading the same general way from nearby points visit the
+        // same parts of the scene, so tracing them in that order keeps
+        // those parts in cache
+        order.resize(wavefront.rays.size());
+        for (unsigned int index = 0; index < order.size(); ++index)
+        {
+            order[index] = std::make_pair(
+                sort_key(wavefront.rays[index], bounds), index);
+        }
+        std::sort(order.begin(), order.end());
+
+        for (unsigned int position = 0; position < order.size(); ++position)
+        {
+            int index = order[position].second;
+            const Ray &ray = wavefront.rays[index];
+
+            Intersection intersection;
+            if (accelerator->closest_intersection(ray, intersection))
+            {
+                wavefront.colors[index] = shade(scene, ray, intersection,
+                                                index, wavefronts[depth + 1]);
+            }
+            else
+            {
+                wavefront.colors[index] = scene.background();
+            }
+        }
     }
 
-    Intersection *intersection = get_closest_intersection(scene, ray);
+    // Rays at the maximum depth are not traced
+    Wavefront &last = wavefronts[m_max_depth];
+    for (unsigned int index = 0; index < last.colors.size(); ++index)
+    {
+        last.colors[index] = scene.background();
+    }
 
-    // If this ray hits nothing, return the background color
-    if (intersection == nullptr)
+    // The rays spawned by each ray follow each other in the order they were
+    // spawned, so every color sums up exactly as in depth-first tracing
+    for (int depth = m_max_depth; depth > INITIAL_DEPTH; --depth)
     {
-        return scene->background();
+        Wavefront &wavefront = wavefronts[depth];
+        Wavefront &previous = wavefronts[depth - 1];
+        for (unsigned int index = 0; index < wavefront.rays.size(); ++index)
+        {
+            previous.colors[wavefront.parents[index]] +=
+                wavefront.colors[index] * wavefront.weights[index];
+        }
     }
+}
 
+Color Raytracer::shade(const SceneSnapshot &scene, const Ray &ray,
+                       Intersection &intersection, int depth) const
+{
     // local illumination
     Color rv = m_phong_shader.shade(scene, intersection);
 
-    float kr = intersection->intersected_shape()->reflective_constant();
-    float kt = intersection->intersected_shape()->transmissive_constant();
+    Ray rays[MAX_SECONDARY_RAYS];
+    float weights[MAX_SECONDARY_RAYS];
+    int count = secondary_rays(ray, intersection, rays, weights);
+    for (int index = 0; index < count; ++index)
+    {
+        rv += trace(scene, rays[index], depth + 1) * weights[index];
+    }
+    return rv;
+}
+
+Color Raytracer::shade(const SceneSnapshot &scene, const Ray &ray,
+                       Intersection &intersection, int index,
+                       Wavefront &next) const
+{
+    // local illumination
+    Color rv = m_phong_shader.shade(scene, intersection);
+
+    Ray rays[MAX_SECONDARY_RAYS];
+    float weights[MAX_SECONDARY_RAYS];
+    int count = secondary_rays(ray, intersection, rays, weights);
+    for (int ray_index = 0; ray_index < count; ++ray_index)
+    {
+        next.add(rays[ray_index], index, weights[ray_index]);
+    }
+    return rv;
+}
+
+int Raytracer::secondary_rays(const Ray &ray, Intersection &intersection,
+                              Ray rays[], float weights[]) const
+{
+    int count = 0;
+
+    float kr = intersection.intersected_shape()->reflective_constant();
+    float kt = intersection.intersected_shape()->transmissive_constant();
 
     // spawn reflection ray
     if (kr > 0)
     {
-        Ray reflection = make_reflection_ray(intersection->normal(), ray,
-                                           intersection->intersection_point());
-        rv += trace(scene, reflection, depth + 1) * kr;
+        rays[count] = make_reflection_ray(intersection.normal(), ray,
+                                          intersection.intersection_point());
+        weights[count++] = kr;
     }
 
     // spawn transmission ray
@@ -103,19 +352,19 @@ Color Raytracer::trace(Scene *scene, Ray ray, int depth)
     {
         float alpha;
         bool insideShape =
-            (dot_product(negate_vector(ray.direction()), intersection->normal()) < 0);
+            (dot_product(-ray.direction(), intersection.normal()) < 0);
 
         if (insideShape)
         {
-            intersection->set_normal(negate_vector(intersection->normal()));
-            alpha = intersection->intersected_shape()->refraction_index();
+            intersection.set_normal(-intersection.normal());
+            alpha = intersection.intersected_shape()->refraction_index();
         }
         else
         {
-            alpha = 1.0 / intersection->intersected_shape()->refraction_index();
+            alpha = 1.0 / intersection.intersected_shape()->refraction_index();
         }
 
-        float cosine = dot_product(negate_vector(ray.direction()), intersection->normal());
+        float cosine = dot_product(-ray.direction(), intersection.normal());
 
         float discriminant = 1.0 + ( (alpha * alpha) *
             ((cosine * cosine) - 1.0) );
@@ -125,39 +374,69 @@ Color Raytracer::trace(Scene *scene, Ray ray, int depth)
         if (total_internal_reflection)
         {
             // use the reflection ray with the kt value
-            Ray reflection = make_reflection_ray(intersection->normal(), ray,
-                                               intersection->intersection_point());
-            rv += trace(scene, reflection, depth + 1) * kt;
+            rays[count] = make_reflection_ray(intersection.normal(), ray,
+                                              intersection.intersection_point());
+            weights[count++] = kt;
         }
         else
         {
             // spawn a transmission ray
-            Ray transmission(intersection->intersection_point(),
-                             normalize(
-                                vector_add(scalar_multiply(ray.direction(), alpha),
-                                    scalar_multiply(intersection->normal(),
-                                        (alpha * cosine) -
-                                            sqrt(discriminant)))));
-
-            rv += trace(scene, transmission, depth + 1) * kt;
+            rays[count] = Ray(intersection.intersection_point(),
+                             normalize(ray.direction() * alpha +
+                                       intersection.normal() *
+                                           ((alpha * cosine) -
+                                               sqrt(discriminant))),
+                             SURFACE_OFFSET);
+            weights[count++] = kt;
         }
     }
-    delete intersection;
+    return count;
+}
 
-    return rv;
+Image *Raytracer::trace_scene(const Scene *scene) const
+{
+    return trace_scene(SceneSnapshot(*scene));
+}
+
+Image *Raytracer::trace_scene(const SceneSnapshot &scene) const
+{
+    return trace_scene(scene, TileCallback());
+}
+
+RenderHandle *Raytracer::trace_scene_async(
+    const SceneSnapshot &scene, const TileCallback &tile_traced) const
+{
+    unsigned int thread_count = effective_thread_count();
+
+    // Always on the pool, even with a single thread, so that the caller
+    // does not wait
+    ThreadPool *pool = acquire_thread_pool(thread_count);
+    RenderHandle *handle = new RenderHandle(this, pool, scene, tile_traced);
+
+    const std::vector<int> &tile_order = handle->m_view.tile_order;
+    for (unsigned int position = 0; position < tile_order.size(); ++position)
+    {
+        int tile = tile_order[position];
+        pool->submit(handle->m_tiles, [handle, tile]()
+            {
+                handle->run_tile(tile);
+            });
+    }
+
+    return handle;
 }
 
-Image *Raytracer::trace_scene(Scene *scene)
+Raytracer::View Raytracer::make_view(const SceneSnapshot &scene) const
 {
-    int scene_height = scene->height();
-    int scene_width = scene->width();
+    int scene_height = scene.height();
+    int scene_width = scene.width();
 
     const float PI = 3.1415926;
 
     std::cout << "scene width: " << scene_width << std::endl;
     std::cout << "scene height: " << scene_height << std::endl;
 
-    Camera camera = scene->camera();
+    const Camera &camera = scene.camera();
 
     float aspect_ratio = float(scene_height) / scene_width;
 
@@ -188,31 +467,236 @@ Image *Raytracer::trace_scene(Scene *scene)
     float current_pixel_x = pixel_x_0;
     float current_pixel_y = pixel_y_0;
 
-    Image *image = new Image(scene_width, scene_height);
+    View view;
+    view.eye = camera.location();
+    view.focal_length = camera.focal_length();
 
+    // Pixel positions are accumulated in the same order whatever the tile
+    // and packet sizes, so that every ray is the same
+    view.pixel_x.resize(scene_width);
     for (int width = 0; width < scene_width; ++width)
     {
-    	current_pixel_y = pixel_y_0;
+        view.pixel_x[width] = current_pixel_x;
+        current_pixel_x += pixel_width;
+    }
+
+    view.pixel_y.resize(scene_height);
+    for (int height = 0; height < scene_height; ++height)
+    {
+        view.pixel_y[height] = current_pixel_y;
+        current_pixel_y += pixel_height;
+    }
+
+    view.tiles_across = (scene_width + m_tile_size - 1) / m_tile_size;
+    int tiles_down = (scene_height + m_tile_size - 1) / m_tile_size;
+    int packets_across = (m_tile_size + m_packet_size - 1) / m_packet_size;
+
+    traverse_grid(m_traversal_order, view.tiles_across, tiles_down,
+                  view.tile_order);
+    traverse_grid(m_traversal_order, packets_across, packets_across,
+                  view.packet_order);
+    traverse_grid(m_traversal_order, m_packet_size, m_packet_size,
+                  view.ray_order);
+
+    return view;
+}
+
+unsigned int Raytracer::effective_thread_count() const
+{
+    std::unique_lock<std::mutex> lock(m_pool_mutex);
+    if (m_thread_count == 0)
+    {
+        return ThreadPool::hardware_threads();
+    }
+    return m_thread_count;
+}
+
+ThreadPool *Raytracer::acquire_thread_pool(unsigned int thread_count) const
+{
+    std::unique_lock<std::mutex> lock(m_pool_mutex);
+    if (m_pool == nullptr)
+    {
+        m_pool = new ThreadPool(thread_count);
+    }
+    ++m_pool_users;
+    return m_pool;
+}
+
+void Raytracer::release_thread_pool() const
+{
+    std::unique_lock<std::mutex> lock(m_pool_mutex);
+    if ((--m_pool_users == 0) && m_pool_stale)
+    {
+        delete m_pool;
+        m_pool = nullptr;
+        m_pool_stale = false;
+    }
+}
 
-    	for (int height = 0; height < scene_height; ++height)
-    	{
-            // Generate the ray
-            Ray ray(scene->camera().location(),
-                    normalize(Vector3d(current_pixel_x, current_pixel_y,
-                    		-camera.focal_length())));
-            Color pixel = trace(scene, ray, INITIAL_DEPTH);
+Image *Raytracer::trace_scene(const SceneSnapshot &scene,
+                              const TileCallback &tile_traced) const
+{
+    View view = make_view(scene);
+    Image *image = new Image(view.pixel_x.size(), view.pixel_y.size());
 
-            // Set the color
-            image->set_pixel(height, width, pixel);
+    unsigned int thread_count = effective_thread_count();
 
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
 
-    		current_pixel_y += pixel_height;
-    	}
+    if ((thread_count == 1) || (view.tile_order.size() == 1))
+    {
+        for (unsigned int position = 0; position < view.tile_order.size();
+             ++position)
+        {
+            trace_tile(scene, view, view.tile_order[position], image,
+                       tile_traced);
+        }
 
-    	current_pixel_x += pixel_width;
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        print_ray_rate(view.pixel_x.size() * view.pixel_y.size(),
+                       elapsed.count());
+        return image;
     }
 
+    ThreadPool *pool = acquire_thread_pool(thread_count);
+
+    // Tile costs vary widely, so every tile is a task of its own and idle
+    // workers steal from busy ones
+    std::vector<ThreadPool::WorkerStatistics> before = pool->statistics();
+
+    ThreadPool::TaskGroup group;
+    for (unsigned int position = 0; position < view.tile_order.size();
+         ++position)
+    {
+        int tile = view.tile_order[position];
+        pool->submit(group, [this, &scene, &view, tile, image,
+                             &tile_traced]()
+            {
+                trace_tile(scene, view, tile, image, tile_traced);
+            });
+    }
+    pool->wait(group);
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    print_ray_rate(view.pixel_x.size() * view.pixel_y.size(),
+                   elapsed.count());
+
+    // Renders sharing the pool at the same time count toward each other's
+    // statistics
+    std::vector<ThreadPool::WorkerStatistics> after = pool->statistics();
+    for (unsigned int index = 0; index < after.size(); ++index)
+    {
+        double busy = after[index].busy_seconds - before[index].busy_seconds;
+        std::cout << "worker " << index << ": "
+                  << after[index].tasks - before[index].tasks << " tiles ("
+                  << after[index].steals - before[index].steals
+                  << " stolen), "
+                  << int(100 * busy / elapsed.count() + 0.5)
+                  << "% busy" << std::endl;
+    }
+    release_thread_pool();
+
     return image;
 }
 
+void Raytracer::trace_tile(const SceneSnapshot &scene, const View &view,
+                           int tile, Image *image,
+                           const TileCallback &tile_traced) const
+{
+    int scene_height = view.pixel_y.size();
+    int scene_width = view.pixel_x.size();
+
+    int tile_left = (tile % view.tiles_across) * m_tile_size;
+    int tile_top = (tile / view.tiles_across) * m_tile_size;
+    int tile_right = std::min(tile_left + m_tile_size, scene_width);
+    int tile_bottom = std::min(tile_top + m_tile_size, scene_height);
+
+    RayPacket packet;
+    Color colors[RayPacket::MAX_SIZE];
+    int pixels[RayPacket::MAX_SIZE];
+
+    // Wavefront tracing keeps the rays of every depth, including those at
+    // the maximum depth, which see the background
+    std::vector<Wavefront> wavefronts;
+    if (m_wavefront && (m_max_depth > INITIAL_DEPTH))
+    {
+        wavefronts.resize(m_max_depth + 1);
+    }
+
+    int packets_across = (m_tile_size + m_packet_size - 1) / m_packet_size;
+
+    // Neighboring pixels are traced together, as a square packet of rays
+    for (unsigned int packet_position = 0;
+         packet_position < view.packet_order.size(); ++packet_position)
+    {
+        int packet_cell = view.packet_order[packet_position];
+        int packet_x = tile_left + (packet_cell % packets_across) *
+                                   m_packet_size;
+        int packet_y = tile_top + (packet_cell / packets_across) *
+                                  m_packet_size;
+        if ((packet_x >= tile_right) || (packet_y >= tile_bottom))
+        {
+            continue;
+        }
+
+        int end_x = std::min(packet_x + m_packet_size, tile_right);
+        int end_y = std::min(packet_y + m_packet_size, tile_bottom);
+
+        // Generate the rays
+        packet.clear();
+        for (unsigned int ray_position = 0;
+             ray_position < view.ray_order.size(); ++ray_position)
+        {
+            int ray_cell = view.ray_order[ray_position];
+            int width = packet_x + ray_cell % m_packet_size;
+            int height = packet_y + ray_cell / m_packet_size;
+            if ((width >= end_x) || (height >= end_y))
+            {
+                continue;
+            }
+
+            Vector3d direction(view.pixel_x[width], view.pixel_y[height],
+                               -view.focal_length);
+            pixels[packet.size()] = height * scene_width + width;
+            packet.add(Ray(view.eye, normalize(direction)));
+        }
+
+        if (!wavefronts.empty())
+        {
+            trace(scene, packet, pixels, wavefronts);
+            continue;
+        }
+
+        trace(scene, packet, colors);
+
+        // Set the colors
+        for (int index = 0; index < packet.size(); ++index)
+        {
+            image->set_pixel(pixels[index] / scene_width,
+                             pixels[index] % scene_width, colors[index]);
+        }
+    }
+
+    if (!wavefronts.empty())
+    {
+        trace_wavefronts(scene, wavefronts);
+
+        const Wavefront &primary = wavefronts[INITIAL_DEPTH];
+        for (unsigned int index = 0; index < primary.rays.size(); ++index)
+        {
+            int pixel = primary.parents[index];
+            image->set_pixel(pixel / scene_width, pixel % scene_width,
+                             primary.colors[index]);
+        }
+    }
+
+    if (tile_traced)
+    {
+        tile_traced(*image, tile_left, tile_top, tile_right, tile_bottom);
+    }
+}
+
 }   // namespace RadRt
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "renderhandle.h"
+
+namespace RadRt
+{
+
+RenderHandle::RenderHandle(const Raytracer *raytracer, ThreadPool *pool,
+                           const SceneSnapshot &scene,
+                           const Raytracer::TileCallback &tile_traced):
+    m_raytracer(raytracer),
+    m_pool(pool),
+    m_scene(scene),
+    m_tile_traced(tile_traced),
+    m_view(raytracer->make_view(scene)),
+    m_pixels(new Image(scene.width(), scene.height())),
+    m_tile_count(m_view.tile_order.size()),
+    m_tiles_traced(0),
+    m_tiles_left(m_tile_count),
+    m_cancelled(false),
+    m_finished(m_promise.get_future().share())
+{
+    if (m_tile_count == 0)
+    {
+        m_promise.set_value();
+    }
+}
+
+RenderHandle::~RenderHandle()
+{
+    cancel();
+    m_pool->wait(m_tiles);
+    m_raytracer->release_thread_pool();
+    delete m_pixels;
+}
+
+Image *RenderHandle::image() const
+{
+    m_finished.wait();
+    return m_pixels;
+}
+
+Image *RenderHandle::take_image()
+{
+    m_finished.wait();
+    Image *pixels = m_pixels;
+    m_pixels = nullptr;
+    return pixels;
+}
+
+float RenderHandle::progress() const
+{
+    if (m_tile_count == 0)
+    {
+        return 1;
+    }
+    return float(m_tiles_traced) / m_tile_count;
+}
+
+void RenderHandle::run_tile(int tile)
+{
+    if (!m_cancelled)
+    {
+        m_raytracer->trace_tile(m_scene, m_view, tile, m_pixels,
+                                m_tile_traced);
+        ++m_tiles_traced;
+    }
+
+    // A render cancelled after its last tile started is still complete
+    if (--m_tiles_left == 0)
+    {
+        if (m_tiles_traced < m_tile_count)
+        {
+            delete m_pixels;
+            m_pixels = nullptr;
+        }
+        m_promise.set_value();
+    }
+}
+
+}   // namespace RadRt
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "traversalorder.h"
+
+#include <cstdint>
+#include <utility>
+
+namespace RadRt
+{
+
+/**
+ * Get the cell at a distance along a Morton curve: the even bits of the
+ * distance give the column and the odd bits the row.
+ */
+static void morton_cell(uint64_t distance, int &column, int &row)
+{
+    column = 0;
+    row = 0;
+    for (int bit = 0; distance != 0; ++bit, distance >>= 2)
+    {
+        column |= int(distance & 1) << bit;
+        row |= int((distance >> 1) & 1) << bit;
+    }
+}
+
+/**
+ * Get the cell at a distance along a Hilbert curve through a square of a
+ * power of two side, building it up from quadrants of side 2, 4 and so on.
+ */
+static void hilbert_cell(int side, uint64_t distance, int &column, int &row)
+{
+    column = 0;
+    row = 0;
+    for (int size = 1; size < side; size *= 2, distance /= 4)
+    {
+        int right = int((distance / 2) & 1);
+        int up = int((distance ^ right) & 1);
+
+        // The lower quadrants hold the curve turned on its side, the lower
+        // right one also mirrored
+        if (up == 0)
+        {
+            if (right == 1)
+            {
+                column = size - 1 - column;
+                row = size - 1 - row;
+            }
+            std::swap(column, row);
+        }
+
+        column += size * right;
+        row += size * up;
+    }
+}
+
+bool traversal_order_from_name(const std::string &name,
+                               TraversalOrder &order)
+{
+    if (name == "scanline")
+    {
+        order = SCANLINE_ORDER;
+    }
+    else if (name == "morton")
+    {
+        order = MORTON_ORDER;
+    }
+    else if (name == "hilbert")
+    {
+        order = HILBERT_ORDER;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void traverse_grid(TraversalOrder order, int columns, int rows,
+                   std::vector<int> &cells)
+{
+    cells.clear();
+    if ((columns <= 0) || (rows <= 0))
+    {
+        return;
+    }
+    cells.reserve(columns * rows);
+
+    if (order == SCANLINE_ORDER)
+    {
+        for (int cell = 0; cell < columns * rows; ++cell)
+        {
+            cells.push_back(cell);
+        }
+        return;
+    }
+
+    int side = 1;
+    while ((side < columns) || (side < rows))
+    {
+        side *= 2;
+    }
+
+    uint64_t length = uint64_t(side) * side;
+    for (uint64_t distance = 0; distance < length; ++distance)
+    {
+        int column;
+        int row;
+        if (order == MORTON_ORDER)
+        {
+            morton_cell(distance, column, row);
+        }
+        else
+        {
+            hilbert_cell(side, distance, column, row);
+        }
+
+        if ((column < columns) && (row < rows))
+        {
+            cells.push_back(row * columns + column);
+        }
+    }
+}
+
+}   // namespace RadRt
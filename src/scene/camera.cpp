@@ -4,6 +4,7 @@
  */
 
 #include "camera.h"
+#include "serialization.h"
 
 namespace RadRt
 {
@@ -24,9 +25,9 @@ Camera::Camera():
 Json::Value Camera::serialize() const
 {
     Json::Value root;
-    root["location"] = m_location.serialize();
-    root["view_vector"] = m_view_vector.serialize();
-    root["up_vector"] = m_up_vector.serialize();
+    root["location"] = to_json(m_location);
+    root["view_vector"] = to_json(m_view_vector);
+    root["up_vector"] = to_json(m_up_vector);
     root["focal_point"] = m_focal_length;
     root["horizontal_spread"] = m_horizontal_spread;
     return root;
@@ -34,9 +35,9 @@ Json::Value Camera::serialize() const
 
 void Camera::deserialize(const Json::Value &root)
 {
-    m_location.deserialize(root["location"]);
-    m_view_vector.deserialize(root["view_vector"]);
-    m_up_vector.deserialize(root["up_vector"]);
+    from_json(root["location"], m_location);
+    from_json(root["view_vector"], m_view_vector);
+    from_json(root["up_vector"], m_up_vector);
     m_focal_length = root["focal_length"].asFloat();
     m_horizontal_spread = root["horizontal_spread"].asFloat();
 }
@@ -1,2 +1,3 @@
 SOURCE += camera.cpp
 SOURCE += scene.cpp
+SOURCE += scenesnapshot.cpp
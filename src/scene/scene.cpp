@@ -4,19 +4,43 @@
  */
 
 #include "scene.h"
+#include "acceleratorfactory.h"
+#include "instance.h"
 #include "json.h"
+#include "mesh.h"
+#include "serialization.h"
 #include "shapefactory.h"
+#include <iostream>
 
 namespace RadRt
 {
 
 const int DEFAULT_WIDTH = 500;
 const int DEFAULT_HEIGHT = 500;
+const char *DEFAULT_ACCELERATOR = "bvh";
+
+/**
+ * 64-bit FNV-1a hash of a string.
+ */
+static uint64_t fnv1a_hash(const std::string &text)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned int index = 0; index < text.size(); ++index)
+    {
+        hash ^= (unsigned char) text[index];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
 
 Scene::Scene():
     m_width(DEFAULT_WIDTH),
     m_height(DEFAULT_WIDTH),
-    m_background(Color::BLACK)
+    m_background(Color::BLACK),
+    m_accelerator_type(DEFAULT_ACCELERATOR),
+    m_accelerator(nullptr),
+    m_shapes_hash(0),
+    m_shapes_hashed(false)
 {
     s_shapes = new ShapeVector();
     m_lights = new LightVector();
@@ -41,11 +65,20 @@ Scene::~Scene()
     s_shapes->clear();
     m_lights->clear();
 
+    // Instances among the shapes refer to the groups, so these go last
+    for (unsigned int index = 0; index < m_groups.size(); ++index)
+    {
+        delete m_groups[index];
+    }
+    m_groups.clear();
+
     delete s_shapes;
     delete m_lights;
+    delete m_accelerator;
 
     s_shapes = nullptr;
     m_lights = nullptr;
+    m_accelerator = nullptr;
 }
 
 Json::Value Scene::serialize() const
@@ -57,7 +90,17 @@ Json::Value Scene::serialize() const
 
     scene["camera"] = m_camera.serialize();
 
-    scene["background_color"] = m_background.serialize();
+    scene["background_color"] = to_json(m_background);
+
+    if (!m_groups.empty())
+    {
+        Json::Value json_groups;
+        for (unsigned int index = 0; index < m_groups.size(); ++index)
+        {
+            json_groups.append(m_groups[index]->serialize());
+        }
+        scene["groups"] = json_groups;
+    }
 
     Json::Value json_shapes;
     ShapeConstIterator shape_iter = s_shapes->begin();
@@ -77,6 +120,8 @@ Json::Value Scene::serialize() const
     }
     scene["lights"] = json_lights;
 
+    scene["accelerator"] = m_accelerator_type;
+
     return scene;
 }
 
@@ -87,17 +132,74 @@ void Scene::deserialize(const Json::Value &root)
 
     m_camera.deserialize(root["camera"]);
 
-    m_background.deserialize(root["background_color"]);
+    from_json(root["background_color"], m_background);
+
+    if (root.isMember("accelerator"))
+    {
+        m_accelerator_type = root["accelerator"].asString();
+    }
+
+    Json::Value json_groups = root["groups"];
+    for (unsigned int index = 0; index < json_groups.size(); ++index)
+    {
+        ShapeGroup *group = new ShapeGroup();
+        group->set_directory(m_directory);
+        group->deserialize(json_groups[index]);
+        m_groups.push_back(group);
+    }
 
     Json::Value json_shapes = root["shapes"];
     ShapeFactory factory;
     for (unsigned int index = 0; index < json_shapes.size(); ++index)
     {
-        Shape *shape = factory.create(json_shapes[index]["type"].asString());
+        std::string type = json_shapes[index]["type"].asString();
+
+        Shape *shape;
+        if (type.compare("instance") == 0)
+        {
+            std::string name = json_shapes[index]["group"].asString();
+            const ShapeGroup *instanced = group(name);
+            if (instanced == nullptr)
+            {
+                std::cerr << "Unknown ShapeGroup: " << name << std::endl;
+                continue;
+            }
+            shape = new Instance(instanced);
+        }
+        else
+        {
+            shape = factory.create(type);
+        }
+
+        Mesh *mesh = dynamic_cast<Mesh*>(shape);
+        if (mesh != nullptr)
+        {
+            mesh->set_directory(m_directory);
+        }
         shape->deserialize(json_shapes[index]);
         s_shapes->push_back(shape);
     }
 
+    // The structure over the shapes depends on nothing else, so only they
+    // and the groups they place key the accelerator cache. Meshes are keyed
+    // by their files as well, which the scene only names.
+    if (!m_accelerator_cache.empty())
+    {
+        Json::FastWriter writer;
+        std::string key = writer.write(json_groups) +
+                          writer.write(json_shapes);
+        for (unsigned int index = 0; index < s_shapes->size(); ++index)
+        {
+            const Mesh *mesh = dynamic_cast<const Mesh*>((*s_shapes)[index]);
+            if (mesh != nullptr)
+            {
+                key += mesh->file_stamp();
+            }
+        }
+        m_shapes_hash = fnv1a_hash(key);
+        m_shapes_hashed = true;
+    }
+
     Json::Value json_lights = root["lights"];
     for (unsigned int index = 0; index < json_lights.size(); ++index)
     {
@@ -105,6 +207,75 @@ void Scene::deserialize(const Json::Value &root)
         light->deserialize(json_lights[index]);
         m_lights->push_back(light);
     }
+
+    build_accelerator();
+}
+
+void Scene::set_scene_file(const std::string &filename)
+{
+    std::string::size_type slash = filename.rfind('/');
+    if (slash == std::string::npos)
+    {
+        m_directory.clear();
+    }
+    else
+    {
+        // A scene in the root directory keeps the slash
+        m_directory = filename.substr(0, (slash == 0) ? 1 : slash);
+    }
+}
+
+const ShapeGroup *Scene::group(const std::string &name) const
+{
+    for (unsigned int index = 0; index < m_groups.size(); ++index)
+    {
+        if (m_groups[index]->name().compare(name) == 0)
+        {
+            return m_groups[index];
+        }
+    }
+    return nullptr;
+}
+
+void Scene::build_accelerator()
+{
+    delete m_accelerator;
+
+    AcceleratorFactory factory;
+    m_accelerator = factory.create(m_accelerator_type);
+    if (m_accelerator == nullptr)
+    {
+        m_accelerator_type = DEFAULT_ACCELERATOR;
+        m_accelerator = factory.create(m_accelerator_type);
+    }
+
+    // The type is part of the key so that switching accelerators does not
+    // try to load another kind of structure
+    bool cached = !m_accelerator_cache.empty() && m_shapes_hashed;
+    uint64_t key = m_shapes_hash ^ fnv1a_hash(m_accelerator_type);
+
+    if (cached && m_accelerator->load(m_accelerator_cache, key, *s_shapes))
+    {
+        return;
+    }
+
+    m_accelerator->build(*s_shapes);
+
+    if (cached)
+    {
+        m_accelerator->save(m_accelerator_cache, key);
+    }
+}
+
+void Scene::update_accelerator()
+{
+    if (m_accelerator == nullptr)
+    {
+        build_accelerator();
+        return;
+    }
+
+    m_accelerator->update(*s_shapes);
 }
 
 }   // namespace RadRt
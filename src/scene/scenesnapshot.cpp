@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "scenesnapshot.h"
+#include "scene.h"
+
+namespace RadRt
+{
+
+SceneSnapshot::SceneSnapshot(const Scene &scene):
+    m_width(scene.width()),
+    m_height(scene.height()),
+    m_camera(scene.camera()),
+    m_background(scene.background()),
+    m_accelerator(scene.accelerator())
+{
+    const LightVector *lights = scene.lights();
+    for (LightConstIterator light = lights->begin(); light != lights->end();
+         ++light)
+    {
+        m_lights.push_back(**light);
+    }
+}
+
+SceneSnapshot::SceneSnapshot(const SceneSnapshot &scene, int width,
+                             int height):
+    m_width(width),
+    m_height(height),
+    m_camera(scene.m_camera),
+    m_background(scene.m_background),
+    m_lights(scene.m_lights),
+    m_accelerator(scene.m_accelerator)
+{
+}
+
+}   // namespace RadRt
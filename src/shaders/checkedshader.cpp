@@ -4,6 +4,7 @@
  */
 
 #include "checkedshader.h"
+#include "serialization.h"
 
 namespace RadRt
 {
@@ -16,11 +17,11 @@ CheckedShader::CheckedShader(Point3d a, Point3d b, Point3d c, Point3d d):
 {
 }
 
-Color CheckedShader::shade( const Point3d &p )
+Color CheckedShader::shade( const Point3d &p ) const
 {
-    Vector3d a_to_p = displacement_vector(p, m_a);
-    Vector3d a_to_d = displacement_vector(m_d, m_a);
-    Vector3d a_to_b = displacement_vector(m_b, m_a);
+    Vector3d a_to_p = p - m_a;
+    Vector3d a_to_d = m_d - m_a;
+    Vector3d a_to_b = m_b - m_a;
 
     float AdistanceP = length(a_to_p);
     a_to_p = normalize(a_to_p);
@@ -50,19 +51,19 @@ Json::Value CheckedShader::serialize() const
 {
     Json::Value root;
     root["type"] = "checked_shader";
-    root["a"] = m_a.serialize();
-    root["b"] = m_b.serialize();
-    root["c"] = m_c.serialize();
-    root["d"] = m_d.serialize();
+    root["a"] = to_json(m_a);
+    root["b"] = to_json(m_b);
+    root["c"] = to_json(m_c);
+    root["d"] = to_json(m_d);
     return root;
 }
 
 void CheckedShader::deserialize(const Json::Value &root)
 {
-    m_a.deserialize(root["a"]);
-    m_b.deserialize(root["b"]);
-    m_c.deserialize(root["c"]);
-    m_d.deserialize(root["d"]);
+    from_json(root["a"], m_a);
+    from_json(root["b"], m_b);
+    from_json(root["c"], m_c);
+    from_json(root["d"], m_d);
 }
 
 }   // namespace RadRt
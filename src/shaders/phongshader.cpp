@@ -4,13 +4,15 @@
  */
 
 #include "phongshader.h"
+#include "accelerator.h"
 #include "ray.h"
 #include "intersection.h"
 
 namespace RadRt
 {
 
-Color PhongShader::shade(Scene *scene, Intersection *intersection)
+Color PhongShader::shade(const SceneSnapshot &scene,
+                         const Intersection &intersection) const
 {
     // Declare the light components
     Color Ka;
@@ -18,69 +20,42 @@ Color PhongShader::shade(Scene *scene, Intersection *intersection)
     Color Ks;
 
     // Compute the ambient component
-    Ka = intersection->intersected_shape()->ambient_color(
-            intersection->intersection_point());
+    Ka = intersection.intersected_shape()->ambient_color(
+            intersection.intersection_point());
 
-    Point3d point = intersection->intersection_point();
-    Shape *shape = intersection->intersected_shape();
-    Vector3d normal = intersection->normal();
+    Point3d point = intersection.intersection_point();
+    const Shape *shape = intersection.intersected_shape();
+    Vector3d normal = intersection.normal();
 
     float Kt = 1;
 
     // For each light source
-    LightVector *lights = scene->lights();
-    LightIterator light = lights->begin();
+    const std::vector<Light> &lights = scene.lights();
+    std::vector<Light>::const_iterator light = lights.begin();
 
-    ShapeVector *shapes = scene->shapes();
-
-    for (; light != lights->end(); ++light)
+    for (; light != lights.end(); ++light)
     {
         // Generate the shadow ray
-        Ray shadow_ray(point,
-                       normalize(displacement_vector((*light)->getPosition(),
-                            point)));
-        // Determine if there is direct line of sight to the intersect point
-        ShapeIterator shape_iter = shapes->begin();
-        bool los = true;
-
-        for (; shape_iter != shapes->end(); ++shape_iter)
-        {
-            // Do not look at the target object
-            if (*shape_iter == shape)
-            {
-                continue;
-            }
-
-            // Get the intersection point
-            Ray *intersected = (*shape_iter)->intersect(shadow_ray);
-
-            // If this point is closer than the closest known point,
-            // there is no line of sight.
-            if ((intersected != nullptr) &&
-                (distance_between(intersected->vertex(), (*light)->getPosition()) <
-                 distance_between(point, (*light)->getPosition())))
-            {
-                delete intersected;
-
-                if ((*shape_iter)->transmissive_constant() > 0)
-                {
-                    Kt *= (*shape_iter)->transmissive_constant();
-                    continue;
-                }
-
-                los = false;
-                break;
-            }
-
-            if (intersected != nullptr)
-                delete intersected;
-        }
+        Vector3d to_light = light->getPosition() - point;
+        float light_distance = length(to_light);
+        Ray shadow_ray(point, normalize(to_light), SURFACE_OFFSET,
+                       light_distance);
+
+        // Determine if there is direct line of sight to the intersect point.
+        // The target object itself is not considered. Transparent objects
+        // in the way only attenuate the light if nothing opaque blocks it,
+        // which keeps the result independent of the order they are found in.
+        float transmission = 1;
+        bool los = !scene.accelerator()->occluded(shadow_ray, &intersection,
+                                                  transmission);
 
         if (los)
         {
+            Kt *= transmission;
+
             Color oKd = shape->diffuse_color(point);
             Color oKs = shape->specular_color();
-            Color lC = (*light)->getColor();
+            Color lC = light->getColor();
             float exp = shape->specular_exponent();
 
             // Compute dot product between shadow and normal. Clamp to zero
@@ -92,12 +67,11 @@ Color PhongShader::shade(Scene *scene, Intersection *intersection)
                 // Add in the diffuse component
                 Kd += oKd * lC * shadow_dot_normal;
 
-                Vector3d R = normalize(vector_subtract(shadow_ray.direction(),
-                                scalar_multiply(normal, 2 * shadow_dot_normal)));
+                Vector3d R = normalize(shadow_ray.direction() -
+                                       normal * (2 * shadow_dot_normal));
 
-                Vector3d V = normalize(displacement_vector(
-                                scene->camera().location(),
-                                    intersection->intersection_point()));
+                Vector3d V = normalize(scene.camera().location() -
+                                       intersection.intersection_point());
 
                 // Compute dot product between reflection ray and viewing ray.
                 // Clamp to zero if the angle is more than 90 degrees.
@@ -4,186 +4,141 @@
  */
 
 #include "cylinder.h"
+#include "intersection.h"
 #include "ray.h"
+#include "serialization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace RadRt
 {
 
 void Cylinder::init()
 {
-    float height = distance_between(m_center_point_1, m_center_point_2);
-    m_orientation = scalar_multiply(displacement_vector(m_center_point_1, m_center_point_2), 1.0/height);
+    m_height = distance_between(m_center_point_1, m_center_point_2);
+    m_orientation = (m_center_point_1 - m_center_point_2) * (1.0/m_height);
+    m_radius_squared = m_radius * m_radius;
+
+    // The end caps are discs of radius r perpendicular to the orientation.
+    // Along each axis a disc extends r * sqrt(1 - o^2) from its center,
+    // where o is the orientation component on that axis.
+    float ox = m_orientation.x_component();
+    float oy = m_orientation.y_component();
+    float oz = m_orientation.z_component();
+    Vector3d extent(m_radius * sqrt(std::max(0.0f, 1 - ox * ox)),
+                    m_radius * sqrt(std::max(0.0f, 1 - oy * oy)),
+                    m_radius * sqrt(std::max(0.0f, 1 - oz * oz)));
+
+    BoundingBox box;
+    box.expand(Point3d(m_center_point_1, extent, 1));
+    box.expand(Point3d(m_center_point_1, extent, -1));
+    box.expand(Point3d(m_center_point_2, extent, 1));
+    box.expand(Point3d(m_center_point_2, extent, -1));
+    set_bounds(box);
 }
 
 Cylinder::~Cylinder()
 {
 }
 
-Ray *Cylinder::intersect(const Ray &ray)
+bool Cylinder::intersect(const Ray &ray, Intersection &hit) const
 {
-    // Side intercept ---------------------------------------------------------
-    // This intercept calculation takes the form of the quadratic equation:
-    // At^2 + Bt + C = 0, where
-    // A is (v - (v*orientation) * orientation)^2
-    // B is 2( (v - orientation * (v*orientation)) *
-    //          (delta_p - (orientation * (delta_p*orientation))))
-    // C is (delta_p - (orientation * (delta_p*orientation)))^2 - r^2
+    // The solid cylinder is the intersection of an infinite cylinder around
+    // the axis and the slab between the two endcap planes. The ray enters
+    // the solid where it has entered both, and leaves it where it leaves
+    // either. Its position is measured in the frame set up by init():
+    // along the axis from the base, and perpendicular to the axis.
     //
-    // orientation is (_cp1 - _cp2)
-    // delta_p is (o - _cp1)
-
-    Vector3d delta_p = displacement_vector(ray.vertex(), m_center_point_1);
-
-    Vector3d common1 = vector_subtract(ray.direction(),
-                        scalar_multiply(m_orientation,
-                            dot_product(ray.direction(), m_orientation)));
-    Vector3d common2 = vector_subtract(delta_p,
-                        scalar_multiply(m_orientation, dot_product(delta_p, m_orientation)));
+    // CylinderBatch repeats these steps exactly, so any change here must
+    // be made there too.
 
-    float A = dot_product(common1, common1);
-    float B = 2 * dot_product(common1, common2);
-    float C = dot_product(common2, common2) - (m_radius * m_radius);
-
-    // The quadratic roots are found using:
-    // roots = (-B +- sqrt(B^2 - 4*A*C))/ (2*A)
-    //
-    // Test the discriminant: B^2 - 4*A*C
+    Vector3d offset = ray.vertex() - m_center_point_2;
 
-    float discriminant = B * B - 4 * A * C;
+    float d_axial = dot_product(ray.direction(), m_orientation);
+    float o_axial = dot_product(offset, m_orientation);
 
-    float t1 = -1;
-    float t2 = -1;
+    // Infinite cylinder: at^2 + 2bt + c = 0 in the perpendicular components
+    float a = dot_product(ray.direction(), ray.direction()) -
+              d_axial * d_axial;
+    float b = dot_product(ray.direction(), offset) - d_axial * o_axial;
+    float c = (dot_product(offset, offset) - o_axial * o_axial) -
+              m_radius_squared;
 
-    if (discriminant >= 0)
+    float t_enter;
+    float t_exit;
+    if (a == 0)
     {
-        // Find all possible side intersections
-        t1 = ( -B + sqrt(discriminant) ) / (2 * A); // side intersection
-        t2 = ( -B - sqrt(discriminant) ) / (2 * A); // side intersection
+        // Parallel to the axis: inside the cylinder everywhere or nowhere
+        if (c >= 0)
+        {
+            return false;
+        }
+        t_enter = -std::numeric_limits<float>::infinity();
+        t_exit = std::numeric_limits<float>::infinity();
     }
-
-    // End intercept ----------------------------------------------------------
-    // This intercept calculation contains two plane interceptions, and then
-    // tests to see if the points lie within the endcaps of the cylinder.
-    //
-
-    float t3 = -1;
-    float t4 = -1;
-
-    // Find intercepts with both planes
-    if (dot_product(ray.direction(), m_orientation) != 0)
+    else
     {
-        t3 = dot_product(displacement_vector(m_center_point_1, ray.vertex()), m_orientation) /
-             dot_product(ray.direction(), m_orientation);
-        t4 = dot_product(displacement_vector(m_center_point_2, ray.vertex()), m_orientation) /
-             dot_product(ray.direction(), m_orientation);
+        float discriminant = b * b - a * c;
+        if (discriminant < 0)
+        {
+            return false;
+        }
+
+        float root = std::sqrt(discriminant);
+        t_enter = (-b - root) / a;
+        t_exit = (-b + root) / a;
     }
-    //-------------------------------------------------------------------------
-
 
-    // Create the four intercept points.
-    Point3d *i1 = nullptr;
-    Point3d *i2 = nullptr;
-    Point3d *i3 = nullptr;
-    Point3d *i4 = nullptr;
-
-    // Eliminate points with negative t-values
-    if (t1 >= 0)
-    {
-    	i1 = new Point3d(ray.vertex(), ray.direction(), t1);
-    }
-    if (t2 >= 0)
-    {
-    	i2 = new Point3d(ray.vertex(), ray.direction(), t2);
-    }
-    if (t3 >= 0)
-    {
-        i3 = new Point3d(ray.vertex(), ray.direction(), t3);
-    }
-    if (t4 >= 0)
+    // Slab between the endcaps
+    if (d_axial == 0)
     {
-        i4 = new Point3d(ray.vertex(), ray.direction(), t4);
+        if ((o_axial < 0) || (o_axial > m_height))
+        {
+            return false;
+        }
     }
-
-    // Check that the points lie within their respective boundaries.
-    // i1 and i2 must be between the two endcaps. i3 and i4 must be
-    // contained in the endcaps.
-    if ((i1 != nullptr) &&
-        ((dot_product(m_orientation, displacement_vector(*i1, m_center_point_1)) > 0) ||
-         (dot_product(m_orientation, displacement_vector(*i1, m_center_point_2)) < 0)))
-    {
-        delete i1;
-        i1 = nullptr;
-    }
-
-    if ((i2 != nullptr) &&
-        ((dot_product(m_orientation, displacement_vector(*i2, m_center_point_1)) > 0) ||
-         (dot_product(m_orientation, displacement_vector(*i2, m_center_point_2)) < 0)))
+    else
     {
-        delete i2;
-        i2 = nullptr;
+        float inverse = 1.0f / d_axial;
+        float t0 = (0 - o_axial) * inverse;
+        float t1 = (m_height - o_axial) * inverse;
+        t_enter = std::max(t_enter, std::min(t0, t1));
+        t_exit = std::min(t_exit, std::max(t0, t1));
     }
 
-    if ((i3 != nullptr) &&
-        (dot_product(displacement_vector(*i3, m_center_point_1),
-                    displacement_vector(*i3, m_center_point_1)) >= (m_radius * m_radius)))
+    // Take the entry point, or the exit point for rays leaving from inside
+    float t = (t_enter >= ray.t_min()) ? t_enter : t_exit;
+    if ((t_enter > t_exit) || !ray.contains(t))
     {
-        delete i3;
-        i3 = nullptr;
+        return false;
     }
 
-    if ((i4 != nullptr) &&
-        (dot_product(displacement_vector(*i4, m_center_point_2),
-                    displacement_vector(*i4, m_center_point_2)) >= (m_radius * m_radius)))
-    {
-        delete i4;
-        i4 = nullptr;
-    }
-
-    // Take the closest remaining point.
-    Point3d* intersect = nullptr;
-    float t = 1000000;
-    if (i1 != nullptr && t1 < t)
-    {
-        intersect = i1;
-        t = t1;
-    }
-    if (i2 != nullptr && t2 < t)
-    {
-        intersect = i2;
-        t = t2;
-    }
-    if (i3 != nullptr && t3 < t)
-    {
-        intersect = i3;
-        t = t3;
-    }
-    if (i4 != nullptr && t4 < t)
-    {
-        intersect = i4;
-        t = t4;
-    }
-
-    // Clean up memory
-    if ((i1 != nullptr) && (i1 != intersect)) delete i1;
-    if ((i2 != nullptr) && (i2 != intersect)) delete i2;
-    if ((i3 != nullptr) && (i3 != intersect)) delete i3;
-    if ((i4 != nullptr) && (i4 != intersect)) delete i4;
+    intersection_at(ray, t, hit);
+    return true;
+}
 
-    if (intersect != nullptr)
-    {
-        Ray *rv = new Ray(*intersect, m_orientation);
-        delete intersect;
-        return rv;
-    }
-    return nullptr;
+void Cylinder::intersection_at(const Ray &ray, float t,
+                               Intersection &hit) const
+{
+    hit = Intersection(t, Point3d(ray.vertex(), ray.direction(), t),
+                       m_orientation, this);
+}
+
+void Cylinder::translate(const Vector3d &offset)
+{
+    m_center_point_1 = m_center_point_1 + offset;
+    m_center_point_2 = m_center_point_2 + offset;
+    init();
 }
 
 Json::Value Cylinder::serialize() const
 {
     Json::Value root = Shape::serialize();
     root["type"] = "cylinder";
-    root["center_1"] = m_center_point_1.serialize();
-    root["center_2"] = m_center_point_2.serialize();
+    root["center_1"] = to_json(m_center_point_1);
+    root["center_2"] = to_json(m_center_point_2);
     root["radius"] = m_radius;
     return root;
 }
@@ -191,8 +146,8 @@ Json::Value Cylinder::serialize() const
 void Cylinder::deserialize(const Json::Value &root)
 {
     Shape::deserialize(root);
-    m_center_point_1.deserialize(root["center_1"]);
-    m_center_point_2.deserialize(root["center_2"]);
+    from_json(root["center_1"], m_center_point_1);
+    from_json(root["center_2"], m_center_point_2);
     m_radius = root["radius"].asFloat();
     init();
 }
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "instance.h"
+#include "accelerator.h"
+#include "intersection.h"
+#include "ray.h"
+#include "serialization.h"
+
+namespace RadRt
+{
+
+Instance::Instance(const ShapeGroup *group):
+    m_group(group),
+    m_scale(1, 1, 1),
+    m_rotation_axis(0, 1, 0),
+    m_rotation_angle(0)
+{
+    init();
+}
+
+void Instance::init()
+{
+    m_to_world = compose(Transform::translation(m_translation),
+                         compose(Transform::rotation(m_rotation_axis,
+                                                     m_rotation_angle),
+                                 Transform::scale(m_scale)));
+    m_to_object = m_to_world.inverse();
+
+    set_bounds(m_to_world.apply(m_group->bounds()));
+}
+
+Ray Instance::to_object(const Ray &ray) const
+{
+    return Ray(m_to_object.apply(ray.vertex()),
+               m_to_object.apply(ray.direction()),
+               ray.t_min(), ray.t_max());
+}
+
+bool Instance::intersect(const Ray &ray, Intersection &hit) const
+{
+    // The direction is not renormalized in object space, so distances
+    // along the ray and its interval are the same in both spaces
+    Intersection inner;
+    if (!m_group->accelerator()->closest_intersection(to_object(ray), inner))
+    {
+        return false;
+    }
+
+    // Normals are carried by the inverse transpose so that they stay
+    // perpendicular to scaled surfaces
+    hit = Intersection(inner.t(),
+                       m_to_world.apply(inner.intersection_point()),
+                       normalize(m_to_object.apply_transposed(inner.normal())),
+                       inner.intersected_shape(), this);
+    return true;
+}
+
+bool Instance::occludes(const Ray &ray, const Intersection *origin,
+                        float &transmission) const
+{
+    // The shapes of the group are shared with other instances, so the
+    // surface the ray leaves from is only skipped within its own instance
+    if ((origin != nullptr) && (origin->instance() != this))
+    {
+        origin = nullptr;
+    }
+
+    return m_group->accelerator()->occluded(to_object(ray), origin,
+                                            transmission);
+}
+
+void Instance::translate(const Vector3d &offset)
+{
+    m_translation = m_translation + offset;
+    init();
+}
+
+Json::Value Instance::serialize() const
+{
+    Json::Value root;
+    root["type"] = "instance";
+    root["group"] = m_group->name();
+    root["scale"] = to_json(m_scale);
+    root["rotation"]["axis"] = to_json(m_rotation_axis);
+    root["rotation"]["angle"] = m_rotation_angle;
+    root["translation"] = to_json(m_translation);
+    return root;
+}
+
+void Instance::deserialize(const Json::Value &root)
+{
+    if (root.isMember("scale"))
+    {
+        from_json(root["scale"], m_scale);
+    }
+    if (root.isMember("rotation"))
+    {
+        from_json(root["rotation"]["axis"], m_rotation_axis);
+        m_rotation_angle = root["rotation"]["angle"].asFloat();
+    }
+    if (root.isMember("translation"))
+    {
+        from_json(root["translation"], m_translation);
+    }
+    init();
+}
+
+}   // namespace RadRt
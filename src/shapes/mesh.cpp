@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "mesh.h"
+#include "intersection.h"
+#include "meshloader.h"
+#include "ray.h"
+#include "serialization.h"
+
+#include <sstream>
+
+#include <sys/stat.h>
+
+namespace RadRt
+{
+
+void Mesh::init()
+{
+    BoundingBox box;
+    for (unsigned int index = 0; index < m_indices.size(); ++index)
+    {
+        box.expand(vertex(m_indices[index]));
+    }
+    set_bounds(box);
+}
+
+BoundingBox Mesh::primitive_bounds(unsigned int index) const
+{
+    BoundingBox box;
+    box.expand(vertex(m_indices[3 * index]));
+    box.expand(vertex(m_indices[3 * index + 1]));
+    box.expand(vertex(m_indices[3 * index + 2]));
+    return box;
+}
+
+void Mesh::triangle(unsigned int index, Point3d &corner, Vector3d &edge1,
+                    Vector3d &edge2) const
+{
+    corner = vertex(m_indices[3 * index]);
+    edge1 = vertex(m_indices[3 * index + 1]) - corner;
+    edge2 = vertex(m_indices[3 * index + 2]) - corner;
+}
+
+bool Mesh::intersect_triangle(unsigned int index, const Ray &ray,
+                              float &t) const
+{
+    // TriangleBatch repeats these steps exactly, so any change here must be
+    // made there too.
+    Point3d corner;
+    Vector3d edge1;
+    Vector3d edge2;
+    triangle(index, corner, edge1, edge2);
+
+    // Solve origin + t * direction = corner + u * edge1 + v * edge2 by
+    // Cramer's rule, with the determinant as a triple product
+    Vector3d p = cross_product(ray.direction(), edge2);
+    float determinant = dot_product(edge1, p);
+    if (determinant == 0)
+    {
+        // The ray is parallel to the triangle
+        return false;
+    }
+    float inverse = 1.0f / determinant;
+
+    Vector3d s = ray.vertex() - corner;
+    float u = dot_product(s, p) * inverse;
+
+    Vector3d q = cross_product(s, edge1);
+    float v = dot_product(ray.direction(), q) * inverse;
+
+    t = dot_product(edge2, q) * inverse;
+
+    // Written so that a NaN fails every test, as it does in TriangleBatch
+    return (u >= 0) && (u <= 1) && (v >= 0) && (u + v <= 1) &&
+           ray.contains(t);
+}
+
+bool Mesh::intersect(const Ray &ray, Intersection &hit) const
+{
+    Ray bounded = ray;
+    int closest = -1;
+
+    for (unsigned int index = 0; index < primitive_count(); ++index)
+    {
+        float t;
+        if (intersect_triangle(index, bounded, t))
+        {
+            bounded.set_t_max(t);
+            closest = index;
+        }
+    }
+
+    if (closest < 0)
+    {
+        return false;
+    }
+
+    intersection_at(ray, bounded.t_max(), closest, hit);
+    return true;
+}
+
+bool Mesh::occludes(const Ray &ray, const Intersection * /* origin */,
+                    float &transmission) const
+{
+    for (unsigned int index = 0; index < primitive_count(); ++index)
+    {
+        float t;
+        if (!intersect_triangle(index, ray, t))
+        {
+            continue;
+        }
+
+        if (transmissive_constant() <= 0)
+        {
+            return true;
+        }
+        transmission *= transmissive_constant();
+    }
+
+    return false;
+}
+
+void Mesh::intersection_at(const Ray &ray, float t, unsigned int triangle,
+                           Intersection &hit) const
+{
+    Point3d corner;
+    Vector3d edge1;
+    Vector3d edge2;
+    this->triangle(triangle, corner, edge1, edge2);
+
+    hit = Intersection(t, Point3d(ray.vertex(), ray.direction(), t),
+                       normalize(cross_product(edge1, edge2)), this);
+}
+
+void Mesh::translate(const Vector3d &offset)
+{
+    m_offset = m_offset + offset;
+
+    for (unsigned int index = 0; index < m_vertices.size(); index += 3)
+    {
+        m_vertices[index] += offset.x_component();
+        m_vertices[index + 1] += offset.y_component();
+        m_vertices[index + 2] += offset.z_component();
+    }
+    init();
+}
+
+Json::Value Mesh::serialize() const
+{
+    Json::Value root = Shape::serialize();
+    root["type"] = "mesh";
+    root["file"] = m_filename;
+    root["offset"] = to_json(m_offset);
+    return root;
+}
+
+void Mesh::deserialize(const Json::Value &root)
+{
+    Shape::deserialize(root);
+    m_filename = root["file"].asString();
+
+    std::string path = m_filename;
+    if (!m_directory.empty() && !path.empty() && (path[0] != '/'))
+    {
+        path = m_directory + "/" + path;
+    }
+
+    MeshLoader loader;
+    loader.load(path, m_vertices, m_indices);
+
+    std::ostringstream stamp;
+    struct stat status;
+    if (stat(path.c_str(), &status) == 0)
+    {
+        stamp << status.st_mtime << "." << status.st_mtim.tv_nsec << ":"
+              << status.st_size;
+    }
+    m_file_stamp = stamp.str();
+
+    m_offset = Vector3d();
+    if (root.isMember("offset"))
+    {
+        Vector3d offset;
+        from_json(root["offset"], offset);
+        translate(offset);
+    }
+    init();
+}
+
+}   // namespace RadRt
@@ -0,0 +1,631 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "meshloader.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace RadRt
+{
+
+namespace
+{
+
+// Longest number the OBJ reader accepts
+const int MAX_NUMBER_LENGTH = 64;
+
+inline bool is_space(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+inline void skip_spaces(const char *&cursor, const char *end)
+{
+    while ((cursor < end) && is_space(*cursor))
+    {
+        ++cursor;
+    }
+}
+
+inline void skip_line(const char *&cursor, const char *end)
+{
+    while ((cursor < end) && (*cursor != '\n'))
+    {
+        ++cursor;
+    }
+}
+
+/**
+ * Read a float from an OBJ line. The mapped file is not null terminated,
+ * so the number is copied out before strtof sees it.
+ */
+bool parse_float(const char *&cursor, const char *end, float &value)
+{
+    skip_spaces(cursor, end);
+
+    char buffer[MAX_NUMBER_LENGTH];
+    int length = 0;
+    while ((cursor < end) && !is_space(*cursor) && (*cursor != '\n'))
+    {
+        if (length == MAX_NUMBER_LENGTH - 1)
+        {
+            return false;
+        }
+        buffer[length++] = *cursor++;
+    }
+    buffer[length] = '\0';
+
+    char *parsed;
+    value = std::strtof(buffer, &parsed);
+    return (length > 0) && (parsed == buffer + length);
+}
+
+/**
+ * Read the vertex of a face corner, given as v, v/vt, v//vn or v/vt/vn.
+ * Negative indices count back from the last vertex read.
+ */
+bool parse_corner(const char *&cursor, const char *end,
+                  unsigned int vertex_count, unsigned int &index)
+{
+    bool negative = (cursor < end) && (*cursor == '-');
+    if (negative)
+    {
+        ++cursor;
+    }
+
+    int64_t value = 0;
+    const char *digits = cursor;
+    while ((cursor < end) && (*cursor >= '0') && (*cursor <= '9'))
+    {
+        value = value * 10 + (*cursor++ - '0');
+        if (value > UINT32_MAX)
+        {
+            return false;
+        }
+    }
+
+    // Skip the texture coordinate and normal indices
+    while ((cursor < end) && !is_space(*cursor) && (*cursor != '\n'))
+    {
+        ++cursor;
+    }
+
+    if ((cursor == digits) || (value == 0))
+    {
+        return false;
+    }
+
+    value = negative ? int64_t(vertex_count) - value : value - 1;
+    if (value < 0)
+    {
+        return false;
+    }
+    index = value;
+    return true;
+}
+
+enum PlyType
+{
+    PLY_INT8,
+    PLY_UINT8,
+    PLY_INT16,
+    PLY_UINT16,
+    PLY_INT32,
+    PLY_UINT32,
+    PLY_FLOAT32,
+    PLY_FLOAT64,
+    PLY_INVALID
+};
+
+const int PLY_TYPE_SIZE[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+PlyType ply_type(const std::string &name)
+{
+    const char *names[][2] = {
+        { "char", "int8" }, { "uchar", "uint8" },
+        { "short", "int16" }, { "ushort", "uint16" },
+        { "int", "int32" }, { "uint", "uint32" },
+        { "float", "float32" }, { "double", "float64" } };
+
+    for (int type = 0; type < PLY_INVALID; ++type)
+    {
+        if ((name == names[type][0]) || (name == names[type][1]))
+        {
+            return PlyType(type);
+        }
+    }
+    return PLY_INVALID;
+}
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type;
+
+    // Type of the item count of a list property, or PLY_INVALID for a
+    // single value
+    PlyType count_type;
+};
+
+struct PlyElement
+{
+    std::string name;
+    unsigned int count;
+    std::vector<PlyProperty> properties;
+};
+
+template <typename T>
+inline double decode(const unsigned char *bytes)
+{
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+/**
+ * Read a binary PLY value, swapping its bytes if the file was written on a
+ * machine of the other endianness.
+ */
+inline bool read_ply_value(const char *&cursor, const char *end,
+                           PlyType type, bool swap, double &value)
+{
+    int size = PLY_TYPE_SIZE[type];
+    if (end - cursor < size)
+    {
+        return false;
+    }
+
+    unsigned char bytes[8];
+    std::memcpy(bytes, cursor, size);
+    cursor += size;
+    if (swap)
+    {
+        std::reverse(bytes, bytes + size);
+    }
+
+    switch (type)
+    {
+        case PLY_INT8:
+            value = decode<int8_t>(bytes);
+            break;
+        case PLY_UINT8:
+            value = decode<uint8_t>(bytes);
+            break;
+        case PLY_INT16:
+            value = decode<int16_t>(bytes);
+            break;
+        case PLY_UINT16:
+            value = decode<uint16_t>(bytes);
+            break;
+        case PLY_INT32:
+            value = decode<int32_t>(bytes);
+            break;
+        case PLY_UINT32:
+            value = decode<uint32_t>(bytes);
+            break;
+        case PLY_FLOAT32:
+            value = decode<float>(bytes);
+            break;
+        default:
+            value = decode<double>(bytes);
+            break;
+    }
+    return true;
+}
+
+/**
+ * Split a polygon into a fan of triangles around its first corner.
+ */
+inline void add_polygon(const std::vector<unsigned int> &corners,
+                        std::vector<unsigned int> &indices)
+{
+    for (unsigned int corner = 2; corner < corners.size(); ++corner)
+    {
+        indices.push_back(corners[0]);
+        indices.push_back(corners[corner - 1]);
+        indices.push_back(corners[corner]);
+    }
+}
+
+}   // namespace
+
+bool MeshLoader::load(const std::string &filename,
+                      std::vector<float> &vertices,
+                      std::vector<unsigned int> &indices)
+{
+    m_filename = filename;
+    vertices.clear();
+    indices.clear();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Cannot open mesh file: " << filename << std::endl;
+        return false;
+    }
+
+    struct stat status;
+    if ((fstat(fd, &status) != 0) || (status.st_size == 0))
+    {
+        std::cerr << "Empty mesh file: " << filename << std::endl;
+        close(fd);
+        return false;
+    }
+
+    size_t size = status.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Cannot map mesh file: " << filename << std::endl;
+        return false;
+    }
+
+    // The file is read front to back exactly once
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    const char *data = static_cast<const char*>(mapping);
+    bool loaded;
+    if ((size >= 4) && (std::memcmp(data, "ply", 3) == 0) &&
+        ((data[3] == '\n') || (data[3] == '\r')))
+    {
+        loaded = load_ply(data, size, vertices, indices);
+    }
+    else
+    {
+        loaded = load_obj(data, size, vertices, indices);
+    }
+    munmap(mapping, size);
+
+    // Every triangle must refer to vertices that exist
+    unsigned int vertex_count = vertices.size() / 3;
+    for (unsigned int index = 0; loaded && index < indices.size(); ++index)
+    {
+        if (indices[index] >= vertex_count)
+        {
+            std::cerr << "Mesh file refers to a missing vertex: " << filename
+                      << std::endl;
+            loaded = false;
+        }
+    }
+
+    if (!loaded)
+    {
+        vertices.clear();
+        indices.clear();
+    }
+    return loaded;
+}
+
+bool MeshLoader::load_obj(const char *data, size_t size,
+                          std::vector<float> &vertices,
+                          std::vector<unsigned int> &indices)
+{
+    const char *cursor = data;
+    const char *end = data + size;
+    unsigned int line = 0;
+    std::vector<unsigned int> corners;
+
+    while (cursor < end)
+    {
+        ++line;
+        skip_spaces(cursor, end);
+
+        bool valid = true;
+        if ((end - cursor >= 2) && (cursor[0] == 'v') && is_space(cursor[1]))
+        {
+            cursor += 2;
+            float coordinates[3];
+            for (int axis = 0; valid && axis < 3; ++axis)
+            {
+                valid = parse_float(cursor, end, coordinates[axis]);
+            }
+            vertices.insert(vertices.end(), coordinates, coordinates + 3);
+        }
+        else if ((end - cursor >= 2) && (cursor[0] == 'f') &&
+                 is_space(cursor[1]))
+        {
+            cursor += 2;
+            corners.clear();
+            while (valid)
+            {
+                skip_spaces(cursor, end);
+                if ((cursor == end) || (*cursor == '\n'))
+                {
+                    break;
+                }
+
+                unsigned int index;
+                valid = parse_corner(cursor, end, vertices.size() / 3, index);
+                corners.push_back(index);
+            }
+            valid = valid && (corners.size() >= 3);
+            add_polygon(corners, indices);
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Malformed OBJ file: " << m_filename << ", line "
+                      << line << std::endl;
+            return false;
+        }
+
+        // Anything else on the line, and any other kind of line, is ignored
+        skip_line(cursor, end);
+        if (cursor < end)
+        {
+            ++cursor;
+        }
+    }
+
+    return true;
+}
+
+bool MeshLoader::load_ply(const char *data, size_t size,
+                          std::vector<float> &vertices,
+                          std::vector<unsigned int> &indices)
+{
+    const char *end = data + size;
+    const char *header_end = nullptr;
+    for (const char *cursor = data; cursor + 10 <= end; ++cursor)
+    {
+        if ((std::memcmp(cursor, "end_header", 10) == 0) &&
+            ((cursor == data) || (cursor[-1] == '\n')))
+        {
+            header_end = cursor + 10;
+            break;
+        }
+    }
+    if (header_end == nullptr)
+    {
+        std::cerr << "PLY file has no end_header: " << m_filename
+                  << std::endl;
+        return false;
+    }
+
+    // The header is text; read it line by line
+    std::istringstream header(std::string(data, header_end));
+    std::string line;
+    std::getline(header, line);
+
+    std::string format;
+    std::vector<PlyElement> elements;
+    while (std::getline(header, line))
+    {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "format")
+        {
+            words >> format;
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        }
+        else if ((keyword == "property") && !elements.empty())
+        {
+            PlyProperty property;
+            std::string type;
+            words >> type;
+            if (type == "list")
+            {
+                std::string count_type;
+                words >> count_type >> type;
+                property.count_type = ply_type(count_type);
+                if (property.count_type == PLY_INVALID)
+                {
+                    property.type = PLY_INVALID;
+                }
+                else
+                {
+                    property.type = ply_type(type);
+                }
+            }
+            else
+            {
+                property.count_type = PLY_INVALID;
+                property.type = ply_type(type);
+            }
+            words >> property.name;
+
+            if (property.type == PLY_INVALID)
+            {
+                std::cerr << "PLY file has a property of unknown type: "
+                          << m_filename << std::endl;
+                return false;
+            }
+            elements.back().properties.push_back(property);
+        }
+    }
+
+    uint16_t probe = 1;
+    bool little_endian_host = (*reinterpret_cast<char*>(&probe) == 1);
+
+    bool swap;
+    if (format == "binary_little_endian")
+    {
+        swap = !little_endian_host;
+    }
+    else if (format == "binary_big_endian")
+    {
+        swap = little_endian_host;
+    }
+    else
+    {
+        std::cerr << "PLY file is not binary: " << m_filename << std::endl;
+        return false;
+    }
+
+    // The binary data starts after the line ending of end_header
+    const char *cursor = header_end;
+    if ((cursor < end) && (*cursor == '\r'))
+    {
+        ++cursor;
+    }
+    if ((cursor < end) && (*cursor == '\n'))
+    {
+        ++cursor;
+    }
+
+    std::vector<unsigned int> corners;
+    for (unsigned int element = 0; element < elements.size(); ++element)
+    {
+        const PlyElement &current = elements[element];
+        bool is_vertex = (current.name == "vertex");
+        bool is_face = (current.name == "face");
+
+        int coordinate_property[3] = { -1, -1, -1 };
+        int index_property = -1;
+        for (unsigned int property = 0;
+             property < current.properties.size(); ++property)
+        {
+            const PlyProperty &p = current.properties[property];
+            bool list = (p.count_type != PLY_INVALID);
+            if (is_vertex && !list && (p.name.size() == 1) &&
+                (p.name[0] >= 'x') && (p.name[0] <= 'z'))
+            {
+                coordinate_property[p.name[0] - 'x'] = property;
+            }
+            else if (is_face && list && ((p.name == "vertex_indices") ||
+                                         (p.name == "vertex_index")))
+            {
+                index_property = property;
+            }
+        }
+
+        if (is_vertex && ((coordinate_property[0] < 0) ||
+                          (coordinate_property[1] < 0) ||
+                          (coordinate_property[2] < 0)))
+        {
+            std::cerr << "PLY vertices lack coordinates: " << m_filename
+                      << std::endl;
+            return false;
+        }
+
+        // Every record takes at least one count or value per property, so
+        // a count the rest of the file cannot hold is caught before room
+        // is reserved for it
+        size_t record_size = 0;
+        for (unsigned int property = 0;
+             property < current.properties.size(); ++property)
+        {
+            const PlyProperty &p = current.properties[property];
+            bool list = (p.count_type != PLY_INVALID);
+            record_size += PLY_TYPE_SIZE[list ? p.count_type : p.type];
+        }
+        if ((record_size > 0) &&
+            (current.count > size_t(end - cursor) / record_size))
+        {
+            std::cerr << "PLY file is truncated: " << m_filename
+                      << std::endl;
+            return false;
+        }
+
+        if (is_vertex)
+        {
+            vertices.reserve(3 * size_t(current.count));
+        }
+        if (is_face)
+        {
+            indices.reserve(3 * size_t(current.count));
+        }
+
+        for (unsigned int record = 0; record < current.count; ++record)
+        {
+            float coordinates[3] = { 0, 0, 0 };
+            for (unsigned int property = 0;
+                 property < current.properties.size(); ++property)
+            {
+                const PlyProperty &p = current.properties[property];
+                double value;
+
+                if (p.count_type == PLY_INVALID)
+                {
+                    if (!read_ply_value(cursor, end, p.type, swap, value))
+                    {
+                        std::cerr << "PLY file is truncated: " << m_filename
+                                  << std::endl;
+                        return false;
+                    }
+                    for (int axis = 0; is_vertex && axis < 3; ++axis)
+                    {
+                        if (coordinate_property[axis] == int(property))
+                        {
+                            coordinates[axis] = value;
+                        }
+                    }
+                    continue;
+                }
+
+                double count;
+                if (!read_ply_value(cursor, end, p.count_type, swap, count))
+                {
+                    std::cerr << "PLY file is truncated: " << m_filename
+                              << std::endl;
+                    return false;
+                }
+
+                bool wanted = (index_property == int(property));
+                if (wanted)
+                {
+                    corners.clear();
+                }
+
+                for (unsigned int item = 0; item < count; ++item)
+                {
+                    if (!read_ply_value(cursor, end, p.type, swap, value))
+                    {
+                        std::cerr << "PLY file is truncated: " << m_filename
+                                  << std::endl;
+                        return false;
+                    }
+                    if (wanted)
+                    {
+                        // Indices may be stored as floats, so anything
+                        // but a whole number that fits is refused
+                        if (!(value >= 0) || (value > UINT_MAX) ||
+                            (value != std::floor(value)))
+                        {
+                            std::cerr << "PLY face has an invalid index: "
+                                      << m_filename << std::endl;
+                            return false;
+                        }
+                        corners.push_back(value);
+                    }
+                }
+
+                if (wanted)
+                {
+                    add_polygon(corners, indices);
+                }
+            }
+
+            if (is_vertex)
+            {
+                vertices.insert(vertices.end(), coordinates, coordinates + 3);
+            }
+        }
+    }
+
+    return true;
+}
+
+}   // namespace RadRt
@@ -1,5 +1,9 @@
 SOURCE += cylinder.cpp
+SOURCE += instance.cpp
+SOURCE += mesh.cpp
+SOURCE += meshloader.cpp
 SOURCE += rectangle.cpp
 SOURCE += shape.cpp
 SOURCE += shapefactory.cpp
+SOURCE += shapegroup.cpp
 SOURCE += sphere.cpp
@@ -4,7 +4,9 @@
  */
 
 #include "rectangle.h"
+#include "intersection.h"
 #include "ray.h"
+#include "serialization.h"
 
 namespace RadRt
 {
@@ -12,72 +14,103 @@ namespace RadRt
 void Rectangle::init()
 {
     // calculate the normal vector
-    Vector3d v1 = displacement_vector(m_b, m_a);
-    Vector3d v2 = displacement_vector(m_d, m_a);
+    Vector3d v1 = m_b - m_a;
+    Vector3d v2 = m_d - m_a;
 
     m_normal = normalize(cross_product(v2, v1));
+
+    // The plane holds the points p with n*p = offset. Points of the plane
+    // are located by (u, v) coordinates along the edges from corner c,
+    // scaled so that the rectangle covers [0, 1) in each.
+    m_plane_offset = dot_product(m_a - Point3d(), m_normal);
+
+    Vector3d edge_u = m_b - m_c;
+    Vector3d edge_v = m_d - m_c;
+    m_edge_u = edge_u * (1.0f / dot_product(edge_u, edge_u));
+    m_edge_v = edge_v * (1.0f / dot_product(edge_v, edge_v));
+
+    BoundingBox box;
+    box.expand(m_a);
+    box.expand(m_b);
+    box.expand(m_c);
+    box.expand(m_d);
+    set_bounds(box);
 }
 
-Ray *Rectangle::intersect(const Ray &ray)
+bool Rectangle::intersect(const Ray &ray, Intersection &hit) const
 {
+    // RectangleBatch repeats these steps exactly, so any change here must
+    // be made there too.
+
     // Check if vector is parallel to plane (no intercept)
-    if (dot_product(ray.direction(), m_normal) == 0)
+    float denominator = dot_product(ray.direction(), m_normal);
+    if (denominator == 0)
     {
-        return nullptr;
+        return false;
     }
 
     // Find the distance from the ray origin to the intersect point
-    float distance = dot_product(displacement_vector(m_a, ray.vertex()),
-                                 m_normal) /
-                     dot_product(ray.direction(), m_normal);
+    float distance = (m_plane_offset -
+                      dot_product(ray.vertex() - Point3d(),
+                                  m_normal)) / denominator;
 
-    if (distance < 0)
+    if (!ray.contains(distance))
     {
-        return nullptr;
+        return false;
     }
 
     // From the distance, calculate the intersect point
     Point3d intersection(ray.vertex(), ray.direction(), distance);
 
     // Test to see if the point is inside the rectangle
-    Vector3d CI = displacement_vector(intersection, m_c);
-    Vector3d CB = displacement_vector(m_b, m_c);
-    Vector3d CD = displacement_vector(m_d, m_c);
+    Vector3d CI = intersection - m_c;
+    float u = dot_product(CI, m_edge_u);
+    float v = dot_product(CI, m_edge_v);
 
-    if (distance_between(intersection, ray.vertex()) < 0.1)
+    if ((u < 0) || (u >= 1) || (v < 0) || (v >= 1))
     {
-        return nullptr;
-    }
-    else if ( (0 <= dot_product(CI, CB)) &&
-              (dot_product(CI, CB) < dot_product(CB, CB)) &&
-              (0 <= dot_product(CI, CD)) &&
-              (dot_product(CI, CD) < dot_product(CD, CD)))
-    {
-        return new Ray(intersection, m_normal);;
+        // does not intersect plane within the rectangle
+        return false;
     }
 
-	// does not intersect plane within the rectangle
-	return nullptr;
+    intersection_at(ray, distance, hit);
+    return true;
+}
+
+void Rectangle::intersection_at(const Ray &ray, float t,
+                                Intersection &hit) const
+{
+    hit = Intersection(t, Point3d(ray.vertex(), ray.direction(), t),
+                       m_normal, this);
+}
+
+void Rectangle::translate(const Vector3d &offset)
+{
+    m_a = m_a + offset;
+    m_b = m_b + offset;
+    m_c = m_c + offset;
+    m_d = m_d + offset;
+    init();
 }
 
 Json::Value Rectangle::serialize() const
 {
     Json::Value root = Shape::serialize();
     root["type"] = "rectangle";
-    root["a"] = m_a.serialize();
-    root["b"] = m_b.serialize();
-    root["c"] = m_c.serialize();
-    root["d"] = m_d.serialize();
+    root["a"] = to_json(m_a);
+    root["b"] = to_json(m_b);
+    root["c"] = to_json(m_c);
+    root["d"] = to_json(m_d);
     return root;
 }
 
 void Rectangle::deserialize(const Json::Value &root)
 {
     Shape::deserialize(root);
-    m_a.deserialize(root["a"]);
-    m_b.deserialize(root["b"]);
-    m_c.deserialize(root["c"]);
-    m_d.deserialize(root["d"]);
+    from_json(root["a"], m_a);
+    from_json(root["b"], m_b);
+    from_json(root["c"], m_c);
+    from_json(root["d"], m_d);
     init();
 }
 
@@ -4,11 +4,27 @@
  */
 
 #include "shape.h"
+#include "intersection.h"
 #include "proceduralshaderfactory.h"
+#include "ray.h"
+#include "serialization.h"
 
 namespace RadRt
 {
 
+Shape::Shape():
+    m_ambient_constant(0),
+    m_diffuse_constant(0),
+    m_specular_constant(0),
+    m_specular_exponent(0),
+    m_reflection_constant(0),
+    m_transmission_constant(0),
+    m_refraction_index(0),
+    m_shader(nullptr),
+    m_bounding_radius(0)
+{
+}
+
 Shape::~Shape()
 {
     if (m_shader != nullptr)
@@ -17,12 +33,49 @@ Shape::~Shape()
     }
 }
 
+void Shape::set_bounds(const BoundingBox &bounds)
+{
+    Vector3d half_diagonal = (bounds.max() - bounds.min()) * 0.5f;
+    set_bounds(bounds, bounds.centroid(), length(half_diagonal));
+}
+
+void Shape::set_bounds(const BoundingBox &bounds, const Point3d &center,
+                       float radius)
+{
+    m_bounds = bounds;
+    m_bounding_center = center;
+    m_bounding_radius = radius;
+}
+
+bool Shape::occludes(const Ray &ray, const Intersection *origin,
+                     float &transmission) const
+{
+    if ((origin != nullptr) && (origin->intersected_shape() == this))
+    {
+        return false;
+    }
+
+    Intersection hit;
+    if (!intersect(ray, hit))
+    {
+        return false;
+    }
+
+    if (m_transmission_constant > 0)
+    {
+        transmission *= m_transmission_constant;
+        return false;
+    }
+
+    return true;
+}
+
 Json::Value Shape::serialize() const
 {
     Json::Value root;
-    root["ambient_color"] = m_ambient_color.serialize();
-    root["diffuse_color"] = m_diffuse_color.serialize();
-    root["specular_color"] = m_specular_color.serialize();
+    root["ambient_color"] = to_json(m_ambient_color);
+    root["diffuse_color"] = to_json(m_diffuse_color);
+    root["specular_color"] = to_json(m_specular_color);
     root["ambient_constant"] = m_ambient_constant;
     root["diffuse_constant"] = m_diffuse_constant;
     root["specular_constant"] = m_specular_constant;
@@ -40,9 +93,9 @@ Json::Value Shape::serialize() const
 
 void Shape::deserialize(const Json::Value &root)
 {
-    m_ambient_color.deserialize(root["ambient_color"]);
-    m_diffuse_color.deserialize(root["diffuse_color"]);
-    m_specular_color.deserialize(root["specular_color"]);
+    from_json(root["ambient_color"], m_ambient_color);
+    from_json(root["diffuse_color"], m_diffuse_color);
+    from_json(root["specular_color"], m_specular_color);
     m_ambient_constant = root["ambient_constant"].asFloat();
     m_diffuse_constant = root["diffuse_constant"].asFloat();
     m_specular_constant = root["specular_constant"].asFloat();
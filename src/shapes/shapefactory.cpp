@@ -5,6 +5,7 @@
 
 #include "shapefactory.h"
 #include "cylinder.h"
+#include "mesh.h"
 #include "rectangle.h"
 #include "sphere.h"
 #include <iostream>
@@ -26,6 +27,10 @@ Shape *ShapeFactory::create(std::string classname)
     {
         return new Cylinder();
     }
+    else if (classname.compare("mesh") == 0)
+    {
+        return new Mesh();
+    }
     else
     {
         std::cerr << "Unknown Shape subclass: " << classname << std::endl;
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "shapegroup.h"
+#include "bvh.h"
+#include "mesh.h"
+#include "shapefactory.h"
+#include <iostream>
+
+namespace RadRt
+{
+
+ShapeGroup::ShapeGroup():
+    m_accelerator(nullptr)
+{
+}
+
+ShapeGroup::~ShapeGroup()
+{
+    for (unsigned int index = 0; index < m_shapes.size(); ++index)
+    {
+        delete m_shapes[index];
+    }
+    delete m_accelerator;
+}
+
+BoundingBox ShapeGroup::bounds() const
+{
+    if (m_accelerator == nullptr)
+    {
+        return BoundingBox();
+    }
+    return m_accelerator->bounds();
+}
+
+Json::Value ShapeGroup::serialize() const
+{
+    Json::Value root;
+    root["name"] = m_name;
+
+    Json::Value json_shapes;
+    for (unsigned int index = 0; index < m_shapes.size(); ++index)
+    {
+        json_shapes.append(m_shapes[index]->serialize());
+    }
+    root["shapes"] = json_shapes;
+
+    return root;
+}
+
+void ShapeGroup::deserialize(const Json::Value &root)
+{
+    m_name = root["name"].asString();
+
+    Json::Value json_shapes = root["shapes"];
+    ShapeFactory factory;
+    for (unsigned int index = 0; index < json_shapes.size(); ++index)
+    {
+        // Groups cannot contain instances, which the factory rejects
+        Shape *shape = factory.create(json_shapes[index]["type"].asString());
+        if (shape == nullptr)
+        {
+            continue;
+        }
+
+        Mesh *mesh = dynamic_cast<Mesh*>(shape);
+        if (mesh != nullptr)
+        {
+            mesh->set_directory(m_directory);
+        }
+        shape->deserialize(json_shapes[index]);
+        m_shapes.push_back(shape);
+    }
+
+    delete m_accelerator;
+    m_accelerator = new Bvh();
+    m_accelerator->build(m_shapes);
+}
+
+}   // namespace RadRt
@@ -4,74 +4,103 @@
  */
 
 #include "sphere.h"
+#include "intersection.h"
 #include "ray.h"
+#include "serialization.h"
+
+#include <cmath>
 
 namespace RadRt
 {
+
+void Sphere::init()
+{
+    set_bounds(BoundingBox(Point3d(m_center.x_coord() - m_radius,
+                                   m_center.y_coord() - m_radius,
+                                   m_center.z_coord() - m_radius),
+                           Point3d(m_center.x_coord() + m_radius,
+                                   m_center.y_coord() + m_radius,
+                                   m_center.z_coord() + m_radius)),
+               m_center, m_radius);
+}
 
-Ray *Sphere::intersect(const Ray &ray)
+bool Sphere::intersect(const Ray &ray, Intersection &hit) const
 {
     // This intercept calculation takes the form of the quadratic equation:
-    // At^2 + Bt + C = 0, where
-    // A is v*v
-    // B is 2(o-_center) * d
-    // C is (o-c)(0-c) * _radius^2
+    // at^2 + 2bt + c = 0, where
+    // a is v*v
+    // b is (o-_center) * v
+    // c is (o-_center)(o-_center) - _radius^2
+    //
+    // SphereBatch repeats these steps exactly, so any change here must be
+    // made there too.
 
-    Vector3d origin_center = displacement_vector(ray.vertex(), m_center);
+    Vector3d origin_center = ray.vertex() - m_center;
 
-    float A = dot_product(ray.direction(), ray.direction());
-    float B = dot_product(origin_center, ray.direction()) * 2.0;
-    float C = dot_product(origin_center, origin_center) - m_radius * m_radius;
+    float a = dot_product(ray.direction(), ray.direction());
+    float b = dot_product(origin_center, ray.direction());
+    float c = dot_product(origin_center, origin_center) - m_radius * m_radius;
 
     // The quadratic roots are found using:
-    // roots = (-B +- sqrt(B^2 - 4*A*C))/ (2*A)
+    // roots = (-b +- sqrt(b^2 - a*c)) / a
     //
-    // Test the discriminant: B^2 - 4*A*C
+    // Test the discriminant: b^2 - a*c
 
-    float discriminant = B * B - 4 * A * C;
+    float discriminant = b * b - a * c;
 
     if (discriminant < 0)
     {
         // no real roots (no intersection)
-        return nullptr;
+        return false;
     }
 
-    float distance1 = ( -B + sqrt(discriminant) ) / (2 * A);
-    float distance2 = ( -B - sqrt(discriminant) ) / (2 * A);
+    float root = std::sqrt(discriminant);
+    float distance1 = (-b + root) / a;
+    float distance2 = (-b - root) / a;
 
     float t;
 
-    float epsilon = 0.2;
-
-    // Choose the minimum, positive distance
-    if ((distance1 > epsilon) && ( (distance1 < distance2) ||
-         (distance2 < epsilon) ))
-    {
-        t = distance1;
-    }
-    else if ((distance2 > epsilon) && ( (distance2 < distance1) ||
-                (distance1 < epsilon) ))
+    // Choose the minimum distance within the interval of the ray. The
+    // second root is never greater than the first.
+    if (ray.contains(distance2))
     {
         t = distance2;
+    }
+    else if (ray.contains(distance1))
+    {
+        t = distance1;
     }
     else
     {
-        return nullptr;
+        return false;
     }
 
+    intersection_at(ray, t, hit);
+    return true;
+}
+
+void Sphere::intersection_at(const Ray &ray, float t,
+                             Intersection &hit) const
+{
     // From the t-value, calculate the intersect point
     Point3d intersection(ray.vertex(), ray.direction(), t);
 
-    Vector3d normal = normalize(displacement_vector(intersection, m_center));
+    Vector3d normal = normalize(intersection - m_center);
 
-    return new Ray(intersection, normal);
+    hit = Intersection(t, intersection, normal, this);
 }
 
+void Sphere::translate(const Vector3d &offset)
+{
+    m_center = m_center + offset;
+    init();
+}
+
 Json::Value Sphere::serialize() const
 {
     Json::Value root = Shape::serialize();
     root["type"] = "sphere";
-    root["center"] = m_center.serialize();
+    root["center"] = to_json(m_center);
     root["radius"] = m_radius;
     return root;
 }
@@ -79,8 +108,9 @@ Json::Value Sphere::serialize() const
 void Sphere::deserialize(const Json::Value &root)
 {
     Shape::deserialize(root);
-    m_center.deserialize(root["center"]);
+    from_json(root["center"], m_center);
     m_radius = root["radius"].asFloat();
+    init();
 }
 
 }   // namespace RadRt
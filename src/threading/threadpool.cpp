@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2013 Thomas Kohlman
+ * See license.txt for copying permission.
+ */
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace RadRt
+{
+
+// Pool and index of the worker running on this thread, if any
+static thread_local const ThreadPool *t_pool = nullptr;
+static thread_local unsigned int t_index = 0;
+
+ThreadPool::ThreadPool(unsigned int thread_count):
+    m_queued(0),
+    m_next_worker(0),
+    m_stopping(false)
+{
+    if (thread_count == 0)
+    {
+        thread_count = hardware_threads();
+    }
+
+    for (unsigned int index = 0; index < thread_count; ++index)
+    {
+        Worker *worker = new Worker();
+        worker->statistics.tasks = 0;
+        worker->statistics.steals = 0;
+        worker->statistics.busy_seconds = 0;
+        worker->depth = 0;
+        m_workers.push_back(worker);
+    }
+
+    for (unsigned int index = 0; index < thread_count; ++index)
+    {
+        m_threads.push_back(std::thread(&ThreadPool::run, this, index));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (unsigned int index = 0; index < m_threads.size(); ++index)
+    {
+        m_threads[index].join();
+    }
+
+    for (unsigned int index = 0; index < m_workers.size(); ++index)
+    {
+        delete m_workers[index];
+    }
+}
+
+unsigned int ThreadPool::hardware_threads()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void ThreadPool::submit(const std::function<void()> &task)
+{
+    submit(m_group, task);
+}
+
+void ThreadPool::submit(TaskGroup &group, const std::function<void()> &task)
+{
+    Task queued;
+    queued.function = task;
+    queued.group = &group;
+    ++group.m_pending;
+
+    // A worker keeps its own tasks, newest last. Tasks from outside go in
+    // at the other end, so that each worker runs those in the order they
+    // were queued.
+    unsigned int index = current_worker();
+    if (index < m_workers.size())
+    {
+        std::unique_lock<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->tasks.push_back(queued);
+    }
+    else
+    {
+        index = m_next_worker++ % m_workers.size();
+        std::unique_lock<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->tasks.push_front(queued);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        ++m_queued;
+    }
+    m_wake.notify_all();
+}
+
+void ThreadPool::wait()
+{
+    wait(m_group);
+}
+
+void ThreadPool::wait(TaskGroup &group)
+{
+    unsigned int index = current_worker();
+    bool worker = (index < m_workers.size());
+
+    while (group.m_pending > 0)
+    {
+        Task task;
+        if (worker && take(index, task))
+        {
+            execute(index, task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if ((group.m_pending > 0) && (!worker || (m_queued == 0)))
+        {
+            // Time blocked here is not work, even if it is spent in a task
+            Clock::time_point blocked = Clock::now();
+            m_wake.wait(lock);
+            if (worker)
+            {
+                std::chrono::duration<double> elapsed =
+                    Clock::now() - blocked;
+                std::unique_lock<std::mutex> worker_lock(
+                    m_workers[index]->mutex);
+                m_workers[index]->statistics.busy_seconds -= elapsed.count();
+            }
+        }
+    }
+}
+
+void ThreadPool::parallel_for(unsigned int begin, unsigned int end,
+                              unsigned int grain,
+                              const std::function<void(unsigned int,
+                                                       unsigned int)> &function)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    // Aim for a few chunks per worker so that uneven chunks balance out
+    unsigned int count = end - begin;
+    unsigned int chunk = std::max(grain, count / (4 * thread_count()) + 1);
+
+    TaskGroup group;
+    for (unsigned int first = begin; first < end; first += chunk)
+    {
+        unsigned int last = std::min(first + chunk, end);
+        submit(group, [&function, first, last]() { function(first, last); });
+    }
+
+    wait(group);
+}
+
+std::vector<ThreadPool::WorkerStatistics> ThreadPool::statistics() const
+{
+    std::vector<WorkerStatistics> statistics;
+    for (unsigned int index = 0; index < m_workers.size(); ++index)
+    {
+        std::unique_lock<std::mutex> lock(m_workers[index]->mutex);
+        statistics.push_back(m_workers[index]->statistics);
+    }
+    return statistics;
+}
+
+unsigned int ThreadPool::current_worker() const
+{
+    return (t_pool == this) ? t_index : m_workers.size();
+}
+
+bool ThreadPool::take(unsigned int index, Task &task)
+{
+    unsigned int count = m_workers.size();
+
+    if (index < count)
+    {
+        Worker *worker = m_workers[index];
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        if (!worker->tasks.empty())
+        {
+            task = worker->tasks.back();
+            worker->tasks.pop_back();
+            --m_queued;
+            return true;
+        }
+    }
+
+    for (unsigned int offset = 1; offset < count; ++offset)
+    {
+        Worker *victim = m_workers[(index + offset) % count];
+        std::unique_lock<std::mutex> lock(victim->mutex);
+        if (!victim->tasks.empty())
+        {
+            task = victim->tasks.front();
+            victim->tasks.pop_front();
+            --m_queued;
+            lock.unlock();
+
+            if (index < count)
+            {
+                std::unique_lock<std::mutex> thief_lock(
+                    m_workers[index]->mutex);
+                ++m_workers[index]->statistics.steals;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::execute(unsigned int index, Task &task)
+{
+    Worker *worker = m_workers[index];
+
+    if (worker->depth++ == 0)
+    {
+        worker->started = Clock::now();
+    }
+
+    task.function();
+
+    {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        ++worker->statistics.tasks;
+        if (--worker->depth == 0)
+        {
+            std::chrono::duration<double> elapsed =
+                Clock::now() - worker->started;
+            worker->statistics.busy_seconds += elapsed.count();
+        }
+    }
+
+    // Wake whoever waits for the group, under the lock so that the wakeup
+    // cannot slip in between their check and their sleep
+    if (--task.group->m_pending == 0)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.notify_all();
+    }
+}
+
+void ThreadPool::run(unsigned int index)
+{
+    t_pool = this;
+    t_index = index;
+
+    while (true)
+    {
+        Task task;
+        if (take(index, task))
+        {
+            execute(index, task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while ((m_queued == 0) && !m_stopping)
+        {
+            m_wake.wait(lock);
+        }
+
+        if ((m_queued == 0) && m_stopping)
+        {
+            return;
+        }
+    }
+}
+
+}   // namespace RadRt